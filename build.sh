@@ -24,6 +24,10 @@ elif [ "$1" = "debug" ]; then
     echo "=== debug ==="
     cmake -DUSE_CUDA=OFF -DCMAKE_BUILD_TYPE=Debug ..
     make -j
+elif [ "$1" = "mpi" ]; then
+    echo "=== mpi ==="
+    cmake -DUSE_CUDA=OFF -DUSE_MPI_PSAT=ON ..
+    make -j
 elif [ "$1" = "sanitize" ]; then
     echo "=== sanitize ==="
     cmake -DUSE_CUDA=OFF -DCMAKE_BUILD_TYPE=Sanitize ..
@@ -1,5 +1,4 @@
 #include "CNF.hpp"
-#include <functional>
 #include <iomanip>
 #include <fstream>
 #include <vector>
@@ -133,99 +132,245 @@ bool fastLEC::CNF::perform_bcp(
     const std::vector<int> &new_decision_lits, // also a flag for re-propagate
     std::vector<int> &new_propagated_lits)
 {
-    assigned.resize(num_vars + 1, false);
-    value.resize(num_vars + 1, false);
+    BCPEngine bcp(*this);
 
-    std::vector<int> q;
+    std::vector<int> base = base_decision_lits;
+    base.insert(
+        base.end(), base_propagated_lits.begin(), base_propagated_lits.end());
+    bool res = !bcp.inconsistent() && bcp.assume(base);
 
-    std::function<bool(int)> enqueue = [&](int lit) -> bool
+    // the literals implied by new_decision_lits, or by everything if there
+    // is no new decision
+    std::vector<bool> given(num_vars + 1, false);
+    unsigned start = 0;
+    if (res && !new_decision_lits.empty())
     {
-        int v = abs(lit);
-        bool val = (lit > 0);
-        if (assigned[v])
+        start = bcp.get_trail().size();
+        res = bcp.assume(new_decision_lits);
+    }
+    for (int lit : unit_clauses)
+        given[abs(lit)] = true;
+    for (int lit : base)
+        given[abs(lit)] = true;
+    for (int lit : new_decision_lits)
+        given[abs(lit)] = true;
+    const std::vector<int> &trail = bcp.get_trail();
+    for (unsigned i = start; i < trail.size(); i++)
+        if (!given[abs(trail[i])])
+            new_propagated_lits.push_back(trail[i]);
+
+    bcp.get_assignment(assigned, value);
+    return res;
+}
+
+bool fastLEC::CNF::residual_circuit(const std::vector<bool> &assigned,
+                                    const std::vector<bool> &value,
+                                    std::vector<int> &res_lits,
+                                    std::vector<int> &res_end_pos) const
+{
+    res_lits.clear();
+    res_end_pos.clear();
+
+    // the components of the residual clauses, by their unassigned variables
+    std::vector<int> comp(num_vars + 1);
+    for (int v = 0; v <= num_vars; v++)
+        comp[v] = v;
+    auto find = [&](int v) -> int
+    {
+        while (comp[v] != v)
+            v = comp[v] = comp[comp[v]];
+        return v;
+    };
+    std::vector<bool> touched(num_vars + 1, false);
+
+    // the residual clauses and their first variables
+    std::vector<int> first_var;
+    int begin = 0;
+    for (int i = 0; i < num_clauses(); i++)
+    {
+        int end = cls_end_pos[i];
+        bool sat = false, shortened = false;
+        unsigned pos = res_lits.size();
+        for (int j = begin; j < end && !sat; j++)
         {
-            if (value[v] != val)
-                return false;
+            int lit = lits[j], v = abs(lit);
+            if (!assigned[v])
+                res_lits.push_back(lit);
+            else if (value[v] == (lit > 0))
+                sat = true;
+            else
+                shortened = true;
         }
-        else
+        begin = end;
+
+        if (sat)
         {
-            assigned[abs(lit)] = true;
-            value[abs(lit)] = (lit > 0);
-            q.emplace_back(lit);
+            res_lits.resize(pos);
+            continue;
         }
-        return true;
-    };
-
-    for (int lit : unit_clauses)
-        enqueue(lit);
+        if (res_lits.size() == pos)
+            return false; // falsified
 
-    for (int lit : base_decision_lits)
-        enqueue(lit);
-
-    for (int lit : base_propagated_lits)
-        enqueue(lit);
+        int root = find(abs(res_lits[pos]));
+        for (unsigned j = pos + 1; j < res_lits.size(); j++)
+        {
+            int r = find(abs(res_lits[j]));
+            if (r != root)
+            {
+                comp[r] = root;
+                touched[root] = touched[root] || touched[r];
+            }
+        }
+        touched[root] = touched[root] || shortened;
+        res_end_pos.push_back(res_lits.size());
+        first_var.push_back(abs(res_lits[pos]));
+    }
 
-    unsigned q_pos = q.size();
+    // keep the touched components only
+    unsigned n = 0, begin_pos = 0, write_pos = 0;
+    for (unsigned i = 0; i < res_end_pos.size(); i++)
+    {
+        unsigned end_pos = res_end_pos[i];
+        if (touched[find(first_var[i])])
+        {
+            for (unsigned j = begin_pos; j < end_pos; j++)
+                res_lits[write_pos++] = res_lits[j];
+            res_end_pos[n++] = write_pos;
+        }
+        begin_pos = end_pos;
+    }
+    res_lits.resize(write_pos);
+    res_end_pos.resize(n);
+    return true;
+}
 
-    for (int lit : new_decision_lits)
-        enqueue(lit);
+// ----------------------------------------------------------------------------
+// BCPEngine
+// ----------------------------------------------------------------------------
 
-    // re-propagate at 0 level
-    if (new_decision_lits.size() == 0)
-        q_pos = 0;
+fastLEC::BCPEngine::BCPEngine(const CNF &cnf)
+    : num_vars(cnf.num_vars), lits(cnf.lits)
+{
+    begins.reserve(cnf.num_clauses() + 1);
+    begins.push_back(0);
+    for (int end : cnf.cls_end_pos)
+        begins.push_back(end);
+    watches.resize(2 * (num_vars + 1));
+    vals.assign(num_vars + 1, 0);
 
-    while (q_pos < q.size())
+    for (int i = 0; i < cnf.num_clauses() && !unsat; i++)
     {
-        int v = abs(q[q_pos++]);
+        int size = begins[i + 1] - begins[i];
+        if (size == 0)
+            unsat = true;
+        else if (size == 1)
+            unsat = !enqueue(lits[begins[i]]);
+        else
+        {
+            watches[w_idx(lits[begins[i]])].push_back(i);
+            watches[w_idx(lits[begins[i] + 1])].push_back(i);
+        }
+    }
+    unsat = unsat || !propagate();
+}
 
-        auto &ws = value[v] ? neg_watches[v] : pos_watches[v];
+bool fastLEC::BCPEngine::enqueue(int lit)
+{
+    int v = lit_value(lit);
+    if (v != 0)
+        return v > 0;
+    vals[abs(lit)] = lit > 0 ? 1 : -1;
+    trail.push_back(lit);
+    return true;
+}
 
-        for (int cls_idx : ws)
+bool fastLEC::BCPEngine::propagate()
+{
+    while (q_head < trail.size())
+    {
+        int false_lit = -trail[q_head++];
+        std::vector<int> &ws = watches[w_idx(false_lit)];
+        unsigned i = 0, j = 0;
+        while (i < ws.size())
         {
-            int unassigned_lit = -1;
-            int unassigned_lit_cnt = 0;
-            bool has_sat_lit = false;
-
-            int cls_begin = get_clause_begin(cls_idx);
-            int cls_end = get_clause_end(cls_idx);
-            for (int i = cls_begin; i < cls_end; i++)
+            int c = ws[i++];
+            int *cls = &lits[begins[c]];
+            int size = begins[c + 1] - begins[c];
+            // the false literal goes to the second watch
+            if (cls[0] == false_lit)
+                std::swap(cls[0], cls[1]);
+            if (lit_value(cls[0]) > 0)
             {
-                int lit = lits[i];
-                if (assigned[abs(lit)])
-                {
-                    if (value[abs(lit)] == (lit > 0))
-                    {
-                        has_sat_lit = true;
-                        break;
-                    }
-                }
-                else
-                {
-                    unassigned_lit = lit;
-                    unassigned_lit_cnt++;
-                }
+                ws[j++] = c;
+                continue;
             }
 
-            if (has_sat_lit)
+            int k = 2;
+            while (k < size && lit_value(cls[k]) < 0)
+                k++;
+            if (k < size)
             {
+                // a new watch, the clause leaves this list
+                std::swap(cls[1], cls[k]);
+                watches[w_idx(cls[1])].push_back(c);
                 continue;
             }
-            else if (unassigned_lit_cnt == 0)
+
+            ws[j++] = c;
+            if (!enqueue(cls[0]))
             {
+                while (i < ws.size())
+                    ws[j++] = ws[i++];
+                ws.resize(j);
+                q_head = trail.size();
                 return false;
             }
-            else if (unassigned_lit_cnt == 1)
-            {
-                int lit = unassigned_lit;
-                if (!assigned[abs(lit)])
-                {
-                    q.emplace_back(lit);
-                    new_propagated_lits.push_back(lit);
-                    assigned[abs(lit)] = true;
-                    value[abs(lit)] = (lit > 0);
-                }
-            }
         }
+        ws.resize(j);
     }
     return true;
-}
\ No newline at end of file
+}
+
+bool fastLEC::BCPEngine::assume(const std::vector<int> &decision_lits)
+{
+    trail_lim.push_back(trail.size());
+    if (unsat)
+        return false;
+    for (int lit : decision_lits)
+        if (!enqueue(lit))
+            return false;
+    return propagate();
+}
+
+bool fastLEC::BCPEngine::imply(int lit)
+{
+    if (unsat || !enqueue(lit))
+        return false;
+    return propagate();
+}
+
+void fastLEC::BCPEngine::backtrack(unsigned lev)
+{
+    if (lev >= trail_lim.size())
+        return;
+    unsigned size = trail_lim[lev];
+    while (trail.size() > size)
+    {
+        vals[abs(trail.back())] = 0;
+        trail.pop_back();
+    }
+    trail_lim.resize(lev);
+    q_head = trail.size();
+}
+
+void fastLEC::BCPEngine::get_assignment(std::vector<bool> &assigned,
+                                        std::vector<bool> &value) const
+{
+    assigned.assign(num_vars + 1, false);
+    value.assign(num_vars + 1, false);
+    for (int lit : trail)
+    {
+        assigned[abs(lit)] = true;
+        value[abs(lit)] = lit > 0;
+    }
+}
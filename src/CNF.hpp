@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vector>
+#include <cstdlib>
 #include <iostream>
 
 namespace fastLEC
@@ -52,11 +53,61 @@ public:
         std::vector<int>
             &new_propagated_lits); // propagated lits by new_decision_lits
 
+    // the residual formula of a circuit encoding under the assignment: the
+    // satisfied clauses are dropped and the false literals removed. only the
+    // components (connected by the unassigned variables) with a shortened
+    // clause are kept, an untouched one is a circuit with free inputs and is
+    // always satisfiable. return false if a clause is falsified.
+    bool residual_circuit(const std::vector<bool> &assigned,
+                          const std::vector<bool> &value,
+                          std::vector<int> &res_lits,
+                          std::vector<int> &res_end_pos) const;
+
     std::vector<std::vector<int>> pos_watches, neg_watches;
     inline int get_clause_begin(int i);
     inline int get_clause_end(int i);
 };
 
+// unit propagation with two watched literals over a copy of the clauses.
+// the assignments are kept on a trail split into levels, so a cube is
+// propagated once and the probes on top of it are undone by backtracking.
+class BCPEngine
+{
+public:
+    explicit BCPEngine(const CNF &cnf);
+
+    // assign the literals on a new level and propagate, false on a conflict
+    // (the caller backtracks below that level)
+    bool assume(const std::vector<int> &decision_lits);
+    // assign an implied literal on the current level and propagate
+    bool imply(int lit);
+    void backtrack(unsigned lev);
+
+    unsigned level() const { return trail_lim.size(); }
+    bool inconsistent() const { return unsat; } // refuted by the level 0
+    bool is_assigned(int var) const { return vals[var] != 0; }
+    bool value(int var) const { return vals[var] > 0; }
+    const std::vector<int> &get_trail() const { return trail; }
+    void get_assignment(std::vector<bool> &assigned,
+                        std::vector<bool> &value) const;
+
+private:
+    int num_vars;
+    std::vector<int> lits;   // the clauses, the watched literals first
+    std::vector<int> begins; // clause i is lits[begins[i], begins[i + 1])
+    std::vector<std::vector<int>> watches; // the clauses watching a literal
+    std::vector<signed char> vals;         // 1 true, -1 false, 0 unassigned
+    std::vector<int> trail;
+    std::vector<unsigned> trail_lim; // the trail size at each level
+    unsigned q_head = 0;
+    bool unsat = false;
+
+    static unsigned w_idx(int lit) { return 2 * abs(lit) + (lit < 0); }
+    int lit_value(int lit) const { return lit > 0 ? vals[lit] : -vals[-lit]; }
+    bool enqueue(int lit);
+    bool propagate();
+};
+
 } // namespace fastLEC
 
 std::ostream &operator<<(std::ostream &os, const fastLEC::CNF &cnf);
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "XAG.hpp"
 #include "AIG.hpp"
 #include "parser.hpp"
+#include "simu.hpp"
 
 extern "C"
 {
@@ -15,6 +16,7 @@ extern "C"
 #include <stdexcept>
 #include <algorithm>
 #include <queue>
+#include <unordered_map>
 #include <unordered_set>
 
 // #define PRT_DEBUG_XAG
@@ -502,11 +504,101 @@ bool XAG::strash_prune(unsigned n1, unsigned n2)
     return true;
 }
 
+bool XAG::miter_halves(std::vector<char> &side) const
+{
+    side.assign(this->max_var + 1, 0);
+    bool found = false;
+    std::vector<int> stack = {this->PO};
+    while (!stack.empty())
+    {
+        int lit = stack.back();
+        stack.pop_back();
+        const Gate &g = this->gates[aiger_var(lit)];
+        if (g.type == GateType::XOR2)
+        {
+            int v0 = aiger_var(g.inputs[0]), v1 = aiger_var(g.inputs[1]);
+            side[std::min(v0, v1)] |= 1;
+            side[std::max(v0, v1)] |= 2;
+            found = true;
+        }
+        else if (g.type == GateType::AND2 && aiger_sign(lit))
+        {
+            // an OR of the miters (or of their complements)
+            stack.push_back(aiger_not(g.inputs[0]));
+            stack.push_back(aiger_not(g.inputs[1]));
+        }
+    }
+    if (!found)
+        return false;
+
+    for (int v = this->max_var; v >= 1; v--)
+    {
+        const Gate &g = this->gates[v];
+        if (side[v] == 0 ||
+            (g.type != GateType::AND2 && g.type != GateType::XOR2))
+            continue;
+        side[aiger_var(g.inputs[0])] |= side[v];
+        side[aiger_var(g.inputs[1])] |= side[v];
+    }
+    return true;
+}
+
+void XAG::structural_hashes(unsigned depth,
+                            std::vector<int> &level,
+                            std::vector<std::vector<uint64_t>> &hashes) const
+{
+    std::vector<int> n_fanouts(this->max_var + 1, 0);
+    level.assign(this->max_var + 1, 0);
+    for (int v = 1; v <= this->max_var; v++)
+    {
+        const Gate &g = this->gates[v];
+        if (g.type != GateType::AND2 && g.type != GateType::XOR2)
+            continue;
+        int v0 = aiger_var(g.inputs[0]), v1 = aiger_var(g.inputs[1]);
+        n_fanouts[v0]++;
+        n_fanouts[v1]++;
+        level[v] = 1 + std::max(level[v0], level[v1]);
+    }
+
+    hashes.assign(depth + 1, std::vector<uint64_t>(this->max_var + 1, 0));
+    for (int v = 1; v <= this->max_var; v++)
+    {
+        const Gate &g = this->gates[v];
+        uint64_t h = mix64(g.type);
+        if (g.type == GateType::PI)
+            h = mix64(h ^ (uint64_t)v);
+        h = mix64(h ^ ((uint64_t)level[v] << 32 | (uint32_t)n_fanouts[v]));
+        hashes[0][v] = h;
+    }
+    for (unsigned d = 1; d <= depth; d++)
+    {
+        for (int v = 1; v <= this->max_var; v++)
+        {
+            const Gate &g = this->gates[v];
+            if (g.type != GateType::AND2 && g.type != GateType::XOR2)
+            {
+                hashes[d][v] = hashes[0][v];
+                continue;
+            }
+            // the fanins are unordered, with their polarities
+            uint64_t h0 = mix64(hashes[d - 1][aiger_var(g.inputs[0])] +
+                                aiger_sign(g.inputs[0]));
+            uint64_t h1 = mix64(hashes[d - 1][aiger_var(g.inputs[1])] +
+                                aiger_sign(g.inputs[1]));
+            hashes[d][v] = mix64(hashes[0][v] ^ std::min(h0, h1) ^
+                                 mix64(std::max(h0, h1)));
+        }
+    }
+}
+
 void XAG::init_var_replace()
 {
     this->var_replace.clear();
     this->var_replace.resize(this->max_var + 1, -1);
+    this->var_replace_phase.clear();
+    this->var_replace_phase.resize(this->max_var + 1, false);
     // for (unsigned i = 0; i < this->var_replace.size(); i++)
+    this->var_replace[0] = 0; // the constant
     for (unsigned l : this->PI)
     {
         int v = aiger_var(l);
@@ -516,193 +608,506 @@ void XAG::init_var_replace()
         this->var_replace[i] = i;
 }
 
-std::shared_ptr<fastLEC::XAG> XAG::extract_sub_graph(std::vector<int> vec_po)
+int XAG::replace_lit(int lit)
 {
-    if (vec_po.size() == 2 && vec_po[0] > vec_po[1])
-        std::swap(vec_po[0], vec_po[1]);
+    int v = aiger_var(lit);
+    int p = this->var_replace[v];
+    if (p != v)
+    {
+        // path compression, accumulating the phases
+        int root_lit = this->replace_lit(aiger_pos_lit(p));
+        this->var_replace_phase[v] =
+            this->var_replace_phase[v] ^ aiger_sign(root_lit);
+        this->var_replace[v] = aiger_var(root_lit);
+    }
+    return aiger_pos_lit(this->var_replace[v]) ^
+        (int)this->var_replace_phase[v] ^ aiger_sign(lit);
+}
+
+int XAG::merge_lits(int x, int y)
+{
+    int root_x = this->replace_lit(x);
+    int root_y = this->replace_lit(y);
+    if (aiger_var(root_x) == aiger_var(root_y))
+        return 0;
+    if (aiger_var(root_x) > aiger_var(root_y))
+        std::swap(root_x, root_y);
+    this->var_replace[aiger_var(root_y)] = aiger_var(root_x);
+    this->var_replace_phase[aiger_var(root_y)] =
+        aiger_sign(root_x) ^ aiger_sign(root_y);
+    return aiger_var(root_y);
+}
+
+// the OR of the literals, as a balanced tree (a shallow PO) of the AND2 gates
+// built by add_gate
+template <typename AddGate>
+static int or_tree(std::vector<int> lits, AddGate add_gate)
+{
+    while (lits.size() > 1)
+    {
+        std::vector<int> next;
+        for (unsigned i = 0; i + 1 < lits.size(); i += 2)
+            next.push_back(aiger_not(add_gate(
+                GateType::AND2, aiger_not(lits[i]), aiger_not(lits[i + 1]))));
+        if (lits.size() % 2 == 1)
+            next.push_back(lits.back());
+        lits.swap(next);
+    }
+    return lits.empty() ? 0 : lits[0];
+}
 
-    std::function<int(int)> find_father = [&](int v) -> int
+void XAG::compact()
+{
+    // the cone of the PO over the replaced literals
+    std::vector<bool> used(this->max_var + 1, false);
+    used[aiger_var(this->replace_lit(this->PO))] = true;
+    for (int v = this->max_var; v > 0; v--)
     {
-        if (this->var_replace[v] != v)
-            this->var_replace[v] = find_father(this->var_replace[v]);
+        const Gate &g = this->gates[v];
+        if (!used[v] || (g.type != GateType::AND2 && g.type != GateType::XOR2))
+            continue;
+        used[aiger_var(this->replace_lit(g.inputs[0]))] = true;
+        used[aiger_var(this->replace_lit(g.inputs[1]))] = true;
+    }
 
-        return this->var_replace[v];
+    // the PIs keep their variables, the gates are renumbered after them
+    int n_fixed = 0;
+    for (int l : this->PI)
+        n_fixed = std::max(n_fixed, aiger_var(l));
+    int n_vars = n_fixed;
+    std::vector<Gate> new_gates;
+    for (int v = 0; v <= n_vars; v++)
+        new_gates.emplace_back(Gate(aiger_pos_lit(v)));
+
+    std::vector<int> lit_map(2 * (this->max_var + 1), -1);
+    lit_map[0] = 0, lit_map[1] = 1;
+    for (int l : this->PI)
+    {
+        int v = aiger_var(l);
+        new_gates[v] = Gate(aiger_pos_lit(v), GateType::PI);
+        lit_map[aiger_pos_lit(v)] = aiger_pos_lit(v);
+        lit_map[aiger_neg_lit(v)] = aiger_neg_lit(v);
+    }
+
+    // the inputs are ordered, the complements of XOR inputs are moved out
+    std::unordered_map<uint64_t, int> strash;
+    auto hash_gate = [&](GateType type, int i0, int i1) -> int
+    {
+        uint64_t key = ((uint64_t)i0 << 33) | ((uint64_t)i1 << 1) |
+            (type == GateType::XOR2 ? 1 : 0);
+        auto it = strash.find(key);
+        if (it != strash.end())
+            return it->second;
+        int o = aiger_pos_lit(++n_vars);
+        new_gates.emplace_back(Gate(o, type, i0, i1));
+        strash.emplace(key, o);
+        return o;
     };
 
-    // ---------------------------------------------------
-    // step1.1: extract the cones
-    // ---------------------------------------------------
-    std::vector<bool> refs(this->max_var + 2, false);
-    int v0 = 0, v1 = 0;
-    int pos = -1;
-    for (unsigned i = 0; i < vec_po.size(); i++)
+    for (int v = 1; v <= this->max_var; v++)
     {
-        int &v = (i == 0) ? v0 : v1;
-        v = find_father(aiger_var(vec_po[i]));
-        pos = std::max(pos, v);
-        refs[v] = true;
+        const Gate &g = this->gates[v];
+        if (!used[v] || (g.type != GateType::AND2 && g.type != GateType::XOR2))
+            continue;
+        int i0 = lit_map[this->replace_lit(g.inputs[0])];
+        int i1 = lit_map[this->replace_lit(g.inputs[1])];
+        if (i0 > i1)
+            std::swap(i0, i1);
+
+        int o = 0;
+        if (g.type == GateType::AND2)
+        {
+            if (i0 == 0 || i0 == (i1 ^ 1))
+                o = 0;
+            else if (i0 == 1 || i0 == i1)
+                o = i1;
+            else
+                o = hash_gate(GateType::AND2, i0, i1);
+        }
+        else
+        {
+            int sign = aiger_sign(i0) ^ aiger_sign(i1);
+            i0 = aiger_strip(i0), i1 = aiger_strip(i1);
+            if (i0 == i1)
+                o = sign;
+            else if (i0 == 0)
+                o = i1 ^ sign;
+            else
+                o = hash_gate(GateType::XOR2, i0, i1) ^ sign;
+        }
+        lit_map[aiger_pos_lit(v)] = o;
+        lit_map[aiger_neg_lit(v)] = aiger_not(o);
     }
+    int new_PO = lit_map[this->replace_lit(this->PO)];
 
-    std::vector<fastLEC::Gate> tmp_gates;
-    tmp_gates.clear();
-    for (; pos >= 0; pos--)
+    // remove the dangling gates left by the constant propagation
+    std::vector<bool> live(n_vars + 1, false);
+    live[aiger_var(new_PO)] = true;
+    for (int v = n_vars; v > 0; v--)
     {
-        if (!refs[pos])
+        const Gate &g = new_gates[v];
+        if (!live[v] || g.type == GateType::PI || g.type == GateType::NUL)
             continue;
+        live[aiger_var(g.inputs[0])] = true;
+        live[aiger_var(g.inputs[1])] = true;
+    }
 
-        Gate &g = this->gates[pos];
+    std::vector<int> renum(2 * (n_vars + 1), -1);
+    for (int v = 0; v <= n_fixed; v++)
+        renum[aiger_pos_lit(v)] = aiger_pos_lit(v);
+    int n_live = n_fixed;
+    for (int v = n_fixed + 1; v <= n_vars; v++)
+        if (live[v])
+            renum[aiger_pos_lit(v)] = aiger_pos_lit(++n_live);
+    auto map_lit = [&](int l) -> int
+    {
+        return renum[aiger_strip(l)] ^ aiger_sign(l);
+    };
 
-        if (g.type == fastLEC::GateType::AND2 ||
-            g.type == fastLEC::GateType::XOR2)
-        {
-            int v_i0 = find_father(aiger_var(g.inputs[0]));
-            int v_i1 = find_father(aiger_var(g.inputs[1]));
-            int l_i0 = aiger_sign(g.inputs[0]) ? aiger_neg_lit(v_i0)
-                                               : aiger_pos_lit(v_i0);
-            int l_i1 = aiger_sign(g.inputs[1]) ? aiger_neg_lit(v_i1)
-                                               : aiger_pos_lit(v_i1);
-            tmp_gates.emplace_back(Gate(g.output, g.type, l_i0, l_i1));
+    std::vector<int> new_PI;
+    for (int l : this->PI)
+        if (live[aiger_var(l)])
+            new_PI.push_back(l);
 
-            refs[v_i1] = true;
-            refs[v_i0] = true;
+    this->max_var = n_live;
+    this->PI.swap(new_PI);
+    this->PO = map_lit(new_PO);
+    this->gates.resize(this->max_var + 1);
+    this->used_gates.clear();
+    for (int v = 0; v <= n_fixed; v++)
+        this->gates[v] = Gate(aiger_pos_lit(v));
+    for (int l : this->PI)
+        this->gates[aiger_var(l)] = new_gates[aiger_var(l)];
+    for (int v = n_fixed + 1; v <= n_vars; v++)
+    {
+        if (!live[v])
+            continue;
+        const Gate &g = new_gates[v];
+        int o = map_lit(g.output);
+        this->gates[aiger_var(o)] =
+            Gate(o, g.type, map_lit(g.inputs[0]), map_lit(g.inputs[1]));
+        this->used_gates.emplace_back(aiger_var(o));
+    }
+
+    // the used literals, as in the construction from the AIG
+    this->used_lits.assign(2 * (this->max_var + 1), false);
+    this->used_lits[this->PO] = true;
+    for (int v = this->max_var; v > n_fixed; v--)
+    {
+        const Gate &g = this->gates[v];
+        if (g.type == GateType::XOR2 || this->used_lits[g.output])
+        {
+            this->used_lits[g.inputs[0]] = true;
+            this->used_lits[g.inputs[1]] = true;
+        }
+        if (g.type == GateType::XOR2 || this->used_lits[aiger_not(g.output)])
+        {
+            this->used_lits[aiger_not(g.inputs[0])] = true;
+            this->used_lits[aiger_not(g.inputs[1])] = true;
         }
     }
-    std::reverse(tmp_gates.begin(), tmp_gates.end());
 
-    // ---------------------------------------------------
-    // step 1.2: add PO gate
-    // ---------------------------------------------------
-    int PO_lit = 0;
-    if (vec_po.size() == 2)
+    // the derived data is recomputed on demand
+    this->topo_idx.clear();
+    this->v_usr.clear();
+    this->varcone_sizes.clear();
+    this->son_var_mapper.clear();
+    this->lmap_xag_to_cnf.clear();
+    this->cnf_backup = nullptr;
+    this->init_var_replace();
+}
+
+std::shared_ptr<fastLEC::XAG>
+XAG::speculative_reduction(const std::vector<std::vector<int>> &pairs)
+{
+    std::shared_ptr<fastLEC::XAG> spec = std::make_shared<fastLEC::XAG>();
+    spec->max_var = this->max_var;
+    spec->num_PIs_org = this->num_PIs_org;
+    spec->PI = this->PI;
+    spec->gates = this->gates;
+    spec->used_gates = this->used_gates;
+
+    spec->init_var_replace();
+    for (auto &pair : pairs)
+        spec->merge_lits(pair[0], pair[1]);
+
+    // the representatives have smaller variables, so that the reduced gates
+    // stay in topological order
+    std::vector<std::pair<int, int>> diffs; // (node, representative)
+    for (int v = 1; v <= this->max_var; v++)
     {
-        PO_lit = aiger_pos_lit(this->max_var + 1);
-        int l0 = aiger_sign(vec_po[0]) ? aiger_neg_lit(v0) : aiger_pos_lit(v0);
-        int l1 = aiger_sign(vec_po[1]) ? aiger_neg_lit(v1) : aiger_pos_lit(v1);
-        tmp_gates.emplace_back(Gate(PO_lit, GateType::XOR2, l0, l1));
+        Gate &g = spec->gates[v];
+        if (spec->var_replace[v] < 0 ||
+            (g.type != GateType::AND2 && g.type != GateType::XOR2))
+            continue;
+        g.inputs[0] = spec->replace_lit(g.inputs[0]);
+        g.inputs[1] = spec->replace_lit(g.inputs[1]);
+
+        int rep = spec->replace_lit(aiger_pos_lit(v));
+        if (rep != aiger_pos_lit(v))
+            diffs.emplace_back(aiger_pos_lit(v), rep);
     }
-    else if (vec_po.size() == 1)
+    if (diffs.empty())
+        return nullptr;
+
+    auto add_gate = [&](GateType type, int i0, int i1) -> int
+    {
+        int o = aiger_pos_lit(++spec->max_var);
+        spec->gates.emplace_back(Gate(o, type, i0, i1));
+        spec->used_gates.emplace_back(aiger_var(o));
+        return o;
+    };
+
+    std::vector<int> miters;
+    for (auto &d : diffs)
+        miters.push_back(add_gate(GateType::XOR2, d.first, d.second));
+    spec->PO = or_tree(miters, add_gate);
+
+    // the merges are in the gates now, extract the cone of the PO
+    spec->init_var_replace();
+    return spec->extract_sub_graph({spec->PO});
+}
+
+std::shared_ptr<fastLEC::XAG>
+XAG::extract_odc_miter(int var,
+                       int rep,
+                       const std::vector<int> &window,
+                       const std::vector<int> &outputs)
+{
+    int org_max_var = this->max_var;
+    rep = this->replace_lit(rep);
+
+    // the copy of each window node, var is replaced by rep
+    std::vector<int> dup(window.size(), 0);
+    auto copy_of = [&](int lit) -> int
+    {
+        lit = this->replace_lit(lit);
+        int v = aiger_var(lit);
+        if (v == var)
+            return rep ^ aiger_sign(lit);
+        auto it = std::lower_bound(window.begin(), window.end(), v);
+        if (it != window.end() && *it == v)
+            return dup[it - window.begin()] ^ aiger_sign(lit);
+        return lit;
+    };
+    // the miter gates are appended to this XAG until the extraction
+    auto add_gate = [&](GateType type, int i0, int i1) -> int
+    {
+        int o = aiger_pos_lit(++this->max_var);
+        this->gates.emplace_back(Gate(o, type, i0, i1));
+        this->var_replace.push_back(this->max_var);
+        this->var_replace_phase.push_back(false);
+        return o;
+    };
+
+    for (unsigned i = 0; i < window.size(); i++)
     {
-        if (v0 == 0 || v0 == 1) // constant
-            PO_lit = v0;
-        else // variables
-            PO_lit =
-                aiger_sign(vec_po[0]) ? aiger_neg_lit(v0) : aiger_pos_lit(v0);
+        if (window[i] == var)
+        {
+            dup[i] = rep;
+            continue;
+        }
+        Gate g = this->gates[window[i]];
+        dup[i] = add_gate(g.type, copy_of(g.inputs[0]), copy_of(g.inputs[1]));
     }
-    else
+
+    std::vector<int> miters;
+    for (int o : outputs)
+    {
+        int lit = aiger_pos_lit(o);
+        miters.push_back(add_gate(GateType::XOR2, lit, copy_of(lit)));
+    }
+    int po = or_tree(miters, add_gate);
+
+    std::shared_ptr<fastLEC::XAG> sub_xag = this->extract_sub_graph({po});
+
+    this->max_var = org_max_var;
+    this->gates.resize(org_max_var + 1);
+    this->var_replace.resize(org_max_var + 1);
+    this->var_replace_phase.resize(org_max_var + 1);
+    return sub_xag;
+}
+
+XAGView::XAGView(fastLEC::XAG &parent, std::vector<int> vec_po)
+    : parent(parent)
+{
+    if (vec_po.size() == 2 && vec_po[0] > vec_po[1])
+        std::swap(vec_po[0], vec_po[1]);
+    if (vec_po.size() != 1 && vec_po.size() != 2)
     {
         printf("Error: vec_po.size() == %zu\n", vec_po.size());
         exit(1);
     }
 
-    // ---------------------------------------------------
-    // step 2: reduce const 0 1 variables
-    // ---------------------------------------------------
-    std::vector<int> mp(2 * (this->max_var + 1 + (vec_po.size() == 2 ? 1 : 0)),
-                        0);
-    for (unsigned i = 0; i < mp.size(); i++)
-        mp[i] = i;
-    std::vector<bool> use_flag(this->max_var + 1 + (vec_po.size() == 2 ? 1 : 0),
-                               false);
-    std::function<int(int)> get_mp = [&](int l) -> int
+    // the cone variables are renumbered from 1 in topological order.
+    // local_var is the index map of the cone, it keeps -1 between the
+    // views (-2: visited), so that only the cone is touched per view
+    static thread_local std::vector<int> local_var;
+    if (local_var.size() < (size_t)parent.max_var + 1)
+        local_var.resize(parent.max_var + 1, -1);
+
+    cone = {0};
+    std::vector<int> stack;
+    auto visit = [&](int lit)
     {
-        if (mp[l] != l)
+        int v = aiger_var(lit);
+        if (v != 0 && local_var[v] == -1)
         {
-            use_flag[aiger_var(l)] = false;
-            mp[l] = get_mp(mp[l]);
+            local_var[v] = -2;
+            cone.push_back(v);
+            stack.push_back(v);
         }
-        use_flag[aiger_var(l)] = true;
-        return mp[l];
     };
-    unsigned i = 0, j = 0;
-    for (; i < tmp_gates.size(); i++)
+
+    int r[2] = {0, 0}; // the replaced PO literals
+    for (unsigned i = 0; i < vec_po.size(); i++)
     {
-        Gate &g = tmp_gates[i];
+        r[i] = parent.replace_lit(vec_po[i]);
+        visit(r[i]);
+    }
+    while (!stack.empty())
+    {
+        const Gate &g = parent.gates[stack.back()];
+        stack.pop_back();
+        if (g.type == GateType::AND2 || g.type == GateType::XOR2)
+        {
+            visit(parent.replace_lit(g.inputs[0]));
+            visit(parent.replace_lit(g.inputs[1]));
+        }
+    }
 
-        unsigned i0 = get_mp(g.inputs[0]);
-        unsigned i1 = get_mp(g.inputs[1]);
+    std::sort(cone.begin() + 1, cone.end());
+    for (unsigned i = 1; i < cone.size(); i++)
+        local_var[cone[i]] = i;
+    auto to_local = [&](int lit) -> int
+    {
+        int v = aiger_var(lit);
+        return v == 0 ? lit : aiger_pos_lit(local_var[v]) ^ aiger_sign(lit);
+    };
 
-        bool keep = false;
-        if (g.type == GateType::AND2)
+    // the fanins are resolved now, var_replace may change after the view
+    unsigned n_cone = cone.size() - 1;
+    fanins.assign(2 * (n_cone + 1 + (vec_po.size() == 2 ? 1 : 0)), 0);
+    for (unsigned i = 1; i <= n_cone; i++)
+    {
+        const Gate &g = parent.gates[cone[i]];
+        if (g.type == GateType::AND2 || g.type == GateType::XOR2)
         {
-            if (i0 == (i1 ^ 1))
-                mp[g.output] = 0, mp[g.output ^ 1] = 1;
-            else if (i0 == i1)
-                mp[g.output] = get_mp(i0), mp[g.output ^ 1] = get_mp(i0 ^ 1),
-                use_flag[aiger_var(g.output)] = true;
-            else if (i0 == 0 || i1 == 0)
-                mp[g.output] = 0, mp[g.output ^ 1] = 1;
-            else if (i0 == 1)
-                mp[g.output] = get_mp(i1), mp[g.output ^ 1] = get_mp(i1 ^ 1);
-            else if (i1 == 1)
-                mp[g.output] = get_mp(i0), mp[g.output ^ 1] = get_mp(i0 ^ 1);
-            else
-                keep = true;
+            fanins[2 * i] = to_local(parent.replace_lit(g.inputs[0]));
+            fanins[2 * i + 1] = to_local(parent.replace_lit(g.inputs[1]));
         }
-        else if (g.type == GateType::XOR2)
+    }
+    r[0] = to_local(r[0]);
+    r[1] = to_local(r[1]);
+    for (unsigned i = 1; i <= n_cone; i++)
+        local_var[cone[i]] = -1;
+
+    if (vec_po.size() == 2)
+    {
+        // the miter of the pair, out of the parent
+        cone.push_back(0);
+        fanins[2 * (n_cone + 1)] = r[0];
+        fanins[2 * (n_cone + 1) + 1] = r[1];
+        po = aiger_pos_lit(n_cone + 1);
+    }
+    else
+        po = r[0]; // maybe a constant
+
+    folded.assign(2 * cone.size(), -1);
+    folded[0] = 0;
+    folded[1] = 1;
+}
+
+GateType XAGView::type(int v) const
+{
+    if (cone[v] == 0)
+        return GateType::XOR2;
+    return parent.gates[cone[v]].type;
+}
+
+int XAGView::fold(int lit) const
+{
+    if (folded[lit] >= 0)
+        return folded[lit];
+
+    // the fanins have smaller local variables, they are folded first
+    std::vector<int> stack = {aiger_var(lit)};
+    while (!stack.empty())
+    {
+        int v = stack.back();
+        if (folded[aiger_pos_lit(v)] >= 0)
         {
-            if (i0 == (i1 ^ 1))
-                mp[g.output] = 1, mp[g.output ^ 1] = 0;
-            else if (i0 == i1)
-                mp[g.output] = 0, mp[g.output ^ 1] = 1;
-            else if (i0 == 0)
-                mp[g.output] = get_mp(i1), mp[g.output ^ 1] = get_mp(i1 ^ 1),
-                use_flag[aiger_var(g.output)] = true;
-            else if (i1 == 0)
-                mp[g.output] = get_mp(i0), mp[g.output ^ 1] = get_mp(i0 ^ 1),
-                use_flag[aiger_var(g.output)] = true;
-            else if (i0 == 1)
-                mp[g.output] = get_mp(i1 ^ 1), mp[g.output ^ 1] = get_mp(i1),
-                use_flag[aiger_var(g.output)] = true;
-            else if (i1 == 1)
-                mp[g.output] = get_mp(i0 ^ 1), mp[g.output ^ 1] = get_mp(i0),
-                use_flag[aiger_var(g.output)] = true;
-            else
-                keep = true;
+            stack.pop_back();
+            continue;
+        }
+        GateType t = type(v);
+        if (t != GateType::AND2 && t != GateType::XOR2)
+        {
+            folded[aiger_pos_lit(v)] = aiger_pos_lit(v);
+            folded[aiger_neg_lit(v)] = aiger_neg_lit(v);
+            stack.pop_back();
+            continue;
+        }
+        int l0 = fanin(v, 0), l1 = fanin(v, 1);
+        if (folded[l0] < 0 || folded[l1] < 0)
+        {
+            if (folded[l0] < 0)
+                stack.push_back(aiger_var(l0));
+            if (folded[l1] < 0)
+                stack.push_back(aiger_var(l1));
+            continue;
         }
+        stack.pop_back();
 
-        if (keep)
+        int i0 = folded[l0], i1 = folded[l1];
+        int res = aiger_pos_lit(v); // kept
+        if (t == GateType::AND2)
         {
-            tmp_gates[j++] = Gate(
-                g.output, g.type, get_mp(g.inputs[0]), get_mp(g.inputs[1]));
+            if (i0 == (i1 ^ 1) || i0 == 0 || i1 == 0)
+                res = 0;
+            else if (i0 == i1 || i1 == 1)
+                res = i0;
+            else if (i0 == 1)
+                res = i1;
         }
+        else
+        {
+            if (i0 == (i1 ^ 1))
+                res = 1;
+            else if (i0 == i1)
+                res = 0;
+            else if (i0 == 0 || i0 == 1)
+                res = i1 ^ i0;
+            else if (i1 == 0 || i1 == 1)
+                res = i0 ^ i1;
+        }
+        folded[aiger_pos_lit(v)] = res;
+        folded[aiger_neg_lit(v)] = res ^ 1;
     }
-    tmp_gates.resize(j);
-    v0 = get_mp(aiger_pos_lit(v0)) >> 1;
-    v1 = get_mp(aiger_pos_lit(v1)) >> 1;
-    PO_lit = get_mp(PO_lit);
+    return folded[lit];
+}
 
-    // ---------------------------------------------------
-    // 2.3 Another cone of influence check
-    // ---------------------------------------------------
-    use_flag.clear();
-    use_flag.resize(this->max_var + 1 + (vec_po.size() == 2 ? 1 : 0), false);
-    use_flag[aiger_var(PO_lit)] = true;
+std::shared_ptr<fastLEC::XAG> XAGView::materialize() const
+{
+    const int n_vars = size();
+    int PO_lit = PO();
 
-    for (int i = (int)tmp_gates.size() - 1; i >= 0; i--)
+    // the cone of influence of the folded PO over the kept gates
+    std::vector<bool> use_flag(n_vars + 1, false);
+    use_flag[aiger_var(PO_lit)] = true;
+    for (int v = n_vars; v >= 1; v--)
     {
-        Gate &g = tmp_gates[i];
-        if (use_flag[aiger_var(g.output)])
-        {
-            use_flag[aiger_var(g.inputs[0])] = true;
-            use_flag[aiger_var(g.inputs[1])] = true;
-        }
+        if (!use_flag[v] || !is_gate(v))
+            continue;
+        use_flag[aiger_var(fold(fanin(v, 0)))] = true;
+        use_flag[aiger_var(fold(fanin(v, 1)))] = true;
     }
 
-    j = 0;
-    for (unsigned i = 0; i < tmp_gates.size(); i++)
-        if (use_flag[aiger_var(tmp_gates[i].output)])
-            tmp_gates[j++] = tmp_gates[i];
-    tmp_gates.resize(j);
-
-    // ---------------------------------------------------
-    // step 3: compact: removing useless variables
-    // ---------------------------------------------------
-    int mapper_cnt = 0; // variable counter
-    // literal mapper, reordering the literals
-    std::vector<int> mapper(
-        2 * (this->max_var + 1 + (vec_po.size() == 2 ? 1 : 0)), -1);
+    // removing the useless variables, the order is kept
+    int mapper_cnt = 0;
+    std::vector<int> mapper(2 * (n_vars + 1), -1);
     mapper[0] = 0, mapper[1] = 1;
-    for (int v = 1; v <= this->max_var + (vec_po.size() == 2 ? 1 : 0); v++)
+    for (int v = 1; v <= n_vars; v++)
     {
         if (use_flag[v])
         {
@@ -712,42 +1117,37 @@ std::shared_ptr<fastLEC::XAG> XAG::extract_sub_graph(std::vector<int> vec_po)
         }
     }
 
-    // ---------------------------------------------------
-    // step 4: build sub-XAG
-    // ---------------------------------------------------
     std::shared_ptr<fastLEC::XAG> sub_xag = std::make_shared<fastLEC::XAG>();
-
     sub_xag->max_var = mapper_cnt;
     sub_xag->used_lits.resize(2 * (sub_xag->max_var + 1), false);
     sub_xag->PI.clear();
     sub_xag->used_gates.clear();
     sub_xag->gates.resize(sub_xag->max_var + 1);
-    for (int l : this->PI)
+    sub_xag->son_var_mapper.resize(sub_xag->max_var + 1, -1);
+    for (int v = 1; v <= n_vars; v++)
     {
-        int v_i = find_father(aiger_var(l));
-        if (use_flag[v_i])
+        if (!use_flag[v])
+            continue;
+        int o = mapper[aiger_pos_lit(v)];
+        if (type(v) == GateType::PI)
         {
-            int pi_l = mapper[aiger_pos_lit(v_i)];
-            sub_xag->PI.push_back(pi_l);
-            sub_xag->gates[aiger_var(pi_l)] =
-                fastLEC::Gate(pi_l, GateType::PI, 0, 0);
+            sub_xag->PI.push_back(o);
+            sub_xag->gates[aiger_var(o)] = fastLEC::Gate(o, GateType::PI, 0, 0);
         }
+        else if (is_gate(v))
+        {
+            int i0 = mapper[fold(fanin(v, 0))];
+            int i1 = mapper[fold(fanin(v, 1))];
+            sub_xag->gates[aiger_var(o)] = fastLEC::Gate(o, type(v), i0, i1);
+            sub_xag->used_gates.emplace_back(aiger_var(o));
+        }
+        if (cone[v] != 0)
+            sub_xag->son_var_mapper[aiger_var(o)] = cone[v];
     }
     sub_xag->num_PIs_org = sub_xag->PI.size();
-
-    for (auto &g : tmp_gates)
-    {
-        int o = mapper[g.output];
-        int i0 = mapper[g.inputs[0]];
-        int i1 = mapper[g.inputs[1]];
-        sub_xag->gates[aiger_var(o)] = fastLEC::Gate(o, g.type, i0, i1);
-        sub_xag->used_gates.emplace_back(aiger_var(o));
-    }
     sub_xag->PO = mapper[PO_lit];
 
-    // ---------------------------------------------------
-    // step 5: mark used literals
-    // ---------------------------------------------------
+    // the used literals and the users
     sub_xag->v_usr.clear();
     sub_xag->v_usr.resize(sub_xag->max_var + 1);
     sub_xag->used_lits[sub_xag->PO] = true;
@@ -773,25 +1173,14 @@ std::shared_ptr<fastLEC::XAG> XAG::extract_sub_graph(std::vector<int> vec_po)
         }
     }
 
-    // ---------------------------------------------------
-    // step 6: father son mapper
-    // ---------------------------------------------------
-    sub_xag->father_var_mapper.resize(this->max_var + 1, -1);
-    sub_xag->son_var_mapper.resize(sub_xag->max_var + 1, -1);
-    for (int v = 1; v <= this->max_var; v++)
-    {
-        int f_v = v;
-        int s_l = mapper[aiger_pos_lit(v)];
-        if (s_l == -1)
-            continue;
-        int s_v = aiger_var(s_l);
-        sub_xag->father_var_mapper[f_v] = s_v;
-        sub_xag->son_var_mapper[s_v] = f_v;
-    }
-
     return sub_xag;
 }
 
+std::shared_ptr<fastLEC::XAG> XAG::extract_sub_graph(std::vector<int> vec_po)
+{
+    return XAGView(*this, vec_po).materialize();
+}
+
 std::shared_ptr<fastLEC::AIG> XAG::construct_aig_from_this_xag()
 {
     std::shared_ptr<fastLEC::AIG> aig = std::make_shared<fastLEC::AIG>();
@@ -1077,38 +1466,37 @@ void fastLEC::XAG::compute_cut_points(const std::vector<int> &selected_vars,
     if (selected_vars.empty())
         return;
 
-    std::vector<bool> is_selected(this->max_var + 1, false);
-    for (int v : selected_vars)
-        is_selected[v] = true;
+    // the arrays are indexed by the position in selected_vars, so that the
+    // cost does not grow with the XAG
+    std::unordered_map<int, int> index;
+    index.reserve(selected_vars.size());
+    for (unsigned i = 0; i < selected_vars.size(); i++)
+        index.emplace(selected_vars[i], i);
 
     int time = 0;
-    std::vector<int> disc(this->max_var + 1, -1);
-    std::vector<int> low(this->max_var + 1, -1);
-    std::vector<int> parent(this->max_var + 1, -1);
-    std::vector<bool> ap(this->max_var + 1, false);
+    std::vector<int> disc(selected_vars.size(), -1);
+    std::vector<int> low(selected_vars.size(), -1);
+    std::vector<int> parent(selected_vars.size(), -1);
+    std::vector<bool> ap(selected_vars.size(), false);
 
     auto get_neighbors = [&](int u, std::vector<int> &neighbors)
     {
         neighbors.clear();
-
-        // check inputs side
+        auto add = [&](int v)
         {
-            int i1 = aiger_var(gates[u].inputs[0]);
-            int i2 = aiger_var(gates[u].inputs[1]);
-
-            if (is_selected[i1])
-                neighbors.push_back(i1);
+            auto it = index.find(v);
+            if (it != index.end())
+                neighbors.push_back(it->second);
+        };
 
-            if (is_selected[i2])
-                neighbors.push_back(i2);
-        }
+        // check inputs side
+        int var = selected_vars[u];
+        add(aiger_var(gates[var].inputs[0]));
+        add(aiger_var(gates[var].inputs[1]));
 
         // check output side
-        for (int v : this->v_usr[u])
-        {
-            if (is_selected[v])
-                neighbors.push_back(v);
-        }
+        for (int v : this->v_usr[var])
+            add(v);
     };
 
     // DFS for articulation points (Tarjan's algorithm)
@@ -1145,13 +1533,13 @@ void fastLEC::XAG::compute_cut_points(const std::vector<int> &selected_vars,
         }
     };
 
-    for (int u : selected_vars)
+    for (unsigned u = 0; u < selected_vars.size(); u++)
         if (disc[u] == -1)
             dfs(u);
 
-    for (int u : selected_vars)
+    for (unsigned u = 0; u < selected_vars.size(); u++)
         if (ap[u])
-            cut_points.push_back(u);
+            cut_points.push_back(selected_vars[u]);
 }
 
 void fastLEC::XAG::compute_v_usr()
@@ -1166,6 +1554,115 @@ void fastLEC::XAG::compute_v_usr()
     }
 }
 
+void fastLEC::XAG::canonical_form(std::vector<int> &form,
+                                  std::vector<int> &pi_label,
+                                  std::vector<bool> &pi_flip) const
+{
+    form.clear();
+    pi_label.assign(this->max_var + 1, 0);
+    pi_flip.assign(this->max_var + 1, false);
+
+    if (this->PO == 0 || this->PO == 1)
+    {
+        form = {0, 0, this->PO};
+        return;
+    }
+
+    auto is_gate = [&](int v)
+    {
+        return this->gates[v].type == GateType::AND2 ||
+            this->gates[v].type == GateType::XOR2;
+    };
+
+    // step 1: structural invariants, blind to PI names and PI polarities
+    std::vector<uint64_t> inv(this->max_var + 1, 0x5bd1e995ull);
+    auto edge_inv = [&](int lit) -> uint64_t
+    {
+        int v = aiger_var(lit);
+        if (!is_gate(v))
+            return inv[v];
+        return mix64(inv[v] + aiger_sign(lit));
+    };
+    for (int v = 1; v <= this->max_var; v++)
+    {
+        if (!is_gate(v))
+            continue;
+        const Gate &g = this->gates[v];
+        uint64_t a = edge_inv(g.inputs[0]);
+        uint64_t b = edge_inv(g.inputs[1]);
+        if (a > b)
+            std::swap(a, b);
+        inv[v] = mix64(mix64(g.type ^ a) ^ b);
+    }
+
+    // step 2: post-order from the PO, fanins ordered by their invariants
+    auto ordered_inputs = [&](int v, int &l0, int &l1)
+    {
+        const Gate &g = this->gates[v];
+        l0 = g.inputs[0], l1 = g.inputs[1];
+        if (edge_inv(l1) < edge_inv(l0))
+            std::swap(l0, l1);
+    };
+
+    std::vector<int> order(this->max_var + 1, 0); // gate id in post-order
+    std::vector<int> post;
+    std::vector<std::pair<int, bool>> stk;
+    if (is_gate(aiger_var(this->PO)))
+        stk.emplace_back(aiger_var(this->PO), false);
+    while (!stk.empty())
+    {
+        auto [v, expanded] = stk.back();
+        stk.pop_back();
+        if (order[v] != 0)
+            continue;
+        if (expanded)
+        {
+            post.push_back(v);
+            order[v] = post.size();
+            continue;
+        }
+        stk.emplace_back(v, true);
+        int l0, l1;
+        ordered_inputs(v, l0, l1);
+        if (is_gate(aiger_var(l1)) && order[aiger_var(l1)] == 0)
+            stk.emplace_back(aiger_var(l1), false);
+        if (is_gate(aiger_var(l0)) && order[aiger_var(l0)] == 0)
+            stk.emplace_back(aiger_var(l0), false);
+    }
+
+    // step 3: emit, PIs are labeled and normalized to the positive polarity
+    // at their first occurrence
+    int n_labels = 0;
+    auto encode = [&](int lit) -> int
+    {
+        int v = aiger_var(lit);
+        if (v == 0) // constant, order 0 is not used by gates
+            return aiger_sign(lit) << 1;
+        if (is_gate(v))
+            return ((order[v] << 1) | aiger_sign(lit)) << 1;
+        if (pi_label[v] == 0)
+        {
+            pi_label[v] = ++n_labels;
+            pi_flip[v] = aiger_sign(lit);
+        }
+        int sign = aiger_sign(lit) ^ (int)pi_flip[v];
+        return (((pi_label[v] << 1) | sign) << 1) | 1;
+    };
+
+    form.reserve(3 * post.size() + 3);
+    form.push_back(post.size());
+    for (int v : post)
+    {
+        int l0, l1;
+        ordered_inputs(v, l0, l1);
+        form.push_back(this->gates[v].type);
+        form.push_back(encode(l0));
+        form.push_back(encode(l1));
+    }
+    form.push_back(encode(this->PO));
+    form.push_back(n_labels);
+}
+
 void fastLEC::XAG::compute_XOR_blocks(std::vector<std::vector<int>> &XOR_blocks,
                                       std::vector<int> &XOR_block_indices)
 {
@@ -1265,6 +1762,56 @@ void fastLEC::XAG::compute_XOR_blocks(std::vector<std::vector<int>> &XOR_blocks,
     }
 }
 
+void fastLEC::XAG::collect_XOR_chain(int v,
+                                     const std::vector<bool> &mask,
+                                     std::vector<bool> &visited,
+                                     std::vector<int> &chain) const
+{
+    std::queue<int> q;
+    q.push(v);
+    visited[v] = true;
+
+    while (!q.empty())
+    {
+        int u = q.front();
+        q.pop();
+        chain.push_back(u);
+
+        // Use nexts to find connected nodes
+        for (int w : this->v_usr[u])
+        {
+            assert(w > 0);
+            if (mask[w] || visited[w])
+                continue;
+
+            // Check if the connection is through an XOR gate
+            const Gate &g = gates[w];
+            if (g.type == GateType::XOR2 && !mask[w] && !visited[w])
+            {
+                visited[w] = true;
+                q.push(w);
+            }
+        }
+
+        const Gate &g = gates[u];
+        if (g.type == GateType::XOR2)
+        {
+            int v1 = aiger_var(g.inputs[0]);
+            int v2 = aiger_var(g.inputs[1]);
+            if (!mask[v1] && !visited[v1])
+            {
+                visited[v1] = true;
+                q.push(v1);
+            }
+            if (!mask[v2] && !visited[v2])
+            {
+                visited[v2] = true;
+                q.push(v2);
+            }
+        }
+    }
+}
+
 void fastLEC::XAG::compute_XOR_chains(
     const std::vector<bool> &mask,
     std::vector<std::vector<int>> &XOR_chains,
@@ -1301,49 +1848,7 @@ void fastLEC::XAG::compute_XOR_chains(
 
         // Start a new XOR chain
         std::vector<int> chain;
-        std::queue<int> q;
-        q.push(v);
-        visited[v] = true;
-
-        while (!q.empty())
-        {
-            int u = q.front();
-            q.pop();
-            chain.push_back(u);
-
-            // Use nexts to find connected nodes
-            for (int w : this->v_usr[u])
-            {
-                assert(w > 0);
-                if (mask[w] || visited[w])
-                    continue;
-
-                // Check if the connection is through an XOR gate
-                const Gate &g = gates[w];
-                if (g.type == GateType::XOR2 && !mask[w] && !visited[w])
-                {
-                    visited[w] = true;
-                    q.push(w);
-                }
-            }
-
-            const Gate &g = gates[u];
-            if (g.type == GateType::XOR2)
-            {
-                int v1 = aiger_var(g.inputs[0]);
-                int v2 = aiger_var(g.inputs[1]);
-                if (!mask[v1] && !visited[v1])
-                {
-                    visited[v1] = true;
-                    q.push(v1);
-                }
-                if (!mask[v2] && !visited[v2])
-                {
-                    visited[v2] = true;
-                    q.push(v2);
-                }
-            }
-        }
+        collect_XOR_chain(v, mask, visited, chain);
 
         // Only add chains that contain at least one XOR gate
         bool has_xor = false;
@@ -1398,46 +1903,21 @@ void fastLEC::XAG::compute_simulation_features(
     entropys.resize(this->max_var + 1, 0.0);
 
     unsigned bv_width = (unsigned)Param::get().custom_params.ls_bv_bits;
-    std::vector<BitVector> states(2 * (this->max_var + 1));
-
-    for (unsigned i = 0; i < this->PI.size(); i++)
-    {
-        int lit = this->PI[i];
-        states[lit].resize(1llu << (bv_width - 1));
-        states[lit].random();
-    }
-    for (auto &gate : this->gates)
-    {
-        if (gate.type == fastLEC::GateType::AND2 ||
-            gate.type == fastLEC::GateType::XOR2)
-        {
-            int rhs0 = gate.inputs[0];
-            int rhs1 = gate.inputs[1];
-            if (aiger_sign(rhs0) && states[rhs0].size() == 0)
-                states[rhs0] = ~states[aiger_not(rhs0)];
-            if (aiger_sign(rhs1) && states[rhs1].size() == 0)
-                states[rhs1] = ~states[aiger_not(rhs1)];
-            if (gate.type == fastLEC::GateType::AND2)
-            {
-                states[gate.output] = states[rhs0] & states[rhs1];
-            }
-            else
-            {
-                states[gate.output] = states[rhs0] ^ states[rhs1];
-            }
-            states[aiger_not(gate.output)] = ~states[gate.output];
-        }
-    }
+    std::vector<SimSignature> sigs;
+    // all the nodes are active: the PO is not checked, so a pattern setting
+    // it does not stop the stream and every node gets all the patterns
+    std::vector<bool> all_active(this->max_var + 1, true);
+    this->stream_simulation(bv_width - 1,
+                            Param::get().custom_params.ls_chunk_bits,
+                            sigs,
+                            &all_active);
+    const uint64_t n_patterns = 1llu << stream_bits(bv_width - 1);
 
-    // printf("PO: %d, %d var_size: %d\n",
-    //        this->PO,
-    //        aiger_var(this->PO),
-    //        this->max_var);
     for (int v = 1; v <= this->max_var; v++)
     {
-        int l = aiger_pos_lit(v);
-        double percentage =
-            (states[l].num_ones() + 0.0) / (1llu << (bv_width - 1));
+        // the ones of the phase-normalized signature, the measure is
+        // symmetric in the phase
+        double percentage = (sigs[v].ones + 0.0) / n_patterns;
 
         percentage = std::abs(percentage - 0.5) * 2;
 
@@ -1454,6 +1934,221 @@ void fastLEC::XAG::compute_simulation_features(
         entropys[v] = entropy;
     }
 }
+
+unsigned fastLEC::XAG::stream_bits(unsigned n_bits)
+{
+    return std::max(n_bits, 6u); // 64 bits for a bv_unit_t
+}
+
+fastLEC::ret_vals
+fastLEC::XAG::stream_simulation(unsigned n_bits,
+                                unsigned chunk_bits,
+                                std::vector<SimSignature> &sigs,
+                                const std::vector<bool> *active)
+{
+    auto is_active = [&](const fastLEC::Gate &gate)
+    {
+        return (gate.type == fastLEC::GateType::AND2 ||
+                gate.type == fastLEC::GateType::XOR2) &&
+            (active == nullptr || (*active)[aiger_var(gate.output)]);
+    };
+
+    const unsigned unit_bits = 6; // 64 bits for a bv_unit_t
+    n_bits = stream_bits(n_bits);
+    chunk_bits = std::min(std::max(chunk_bits, unit_bits), n_bits);
+    const uint64_t n_chunks = 1llu << (n_bits - chunk_bits);
+    const unsigned chunk_units = 1u << (chunk_bits - unit_bits);
+
+    sigs.clear();
+    sigs.resize(this->max_var + 1);
+
+    // the data is the chunk-th run of n words of the node
+    auto absorb =
+        [&](int var, const bv_unit_t *data, unsigned n, uint64_t chunk)
+    {
+        SimSignature &sig = sigs[var];
+        sig.valid = true;
+        if (chunk == 0)
+            sig.phase = data[0] & 1;
+        bv_unit_t neg = sig.phase ? ~0ull : 0ull;
+        for (unsigned i = 0; i < n; i++)
+        {
+            bv_unit_t d = data[i] ^ neg;
+            uint64_t pos = chunk * n + i;
+            if (pos < SimSignature::prefix_units)
+                sig.prefix[pos] = d;
+            sig.ones += __builtin_popcountll(d);
+            sig.hash = ((sig.hash << 5) | (sig.hash >> 59)) ^ d;
+            sig.hash *= 0x9e3779b97f4a7c15ull;
+        }
+    };
+
+    // the compiled iES program saving every node, the runs are narrowed
+    // until the buffer of the observed values stays in the cache (1 MB)
+    ISimulator is;
+    if (Param::get().custom_params.ls_ies &&
+        is.init_glob_ES(*this, true, active))
+    {
+        uint64_t n_words = chunk_units;
+        uint64_t total_words = n_chunks * chunk_units;
+        while (n_words > 8 &&
+               n_words * sizeof(bv_unit_t) * is.obs_vars.size() > (1 << 20))
+            n_words >>= 1;
+
+        std::vector<bv_unit_t> pi_vals(this->PI.size() * n_words);
+        std::vector<bv_unit_t> obs(is.obs_vars.size() * n_words);
+        std::vector<bv_unit_t> zeros(n_words, 0);
+        for (uint64_t run = 0; run < total_words / n_words; run++)
+        {
+            for (auto &w : pi_vals)
+                w = ResMgr::get().random_uint64();
+            ret_vals ret = is.run_observe(
+                pi_vals.data(), n_words, obs.data(), Param::get().n_threads);
+            if (ret == ret_vals::ret_SAT)
+                return ret;
+            absorb(0, zeros.data(), n_words, run);
+            for (unsigned k = 0; k < is.obs_vars.size(); k++)
+                absorb(is.obs_vars[k], obs.data() + k * n_words, n_words, run);
+        }
+
+        if (Param::get().verbose > 1)
+        {
+            printf("c [logSim] iES observing %zu nodes, %llu runs of %llu "
+                   "words, %u ops\n",
+                   is.obs_vars.size(),
+                   (unsigned long long)(total_words / n_words),
+                   (unsigned long long)n_words,
+                   is.glob_es.n_ops);
+            fflush(stdout);
+        }
+        return ret_vals::ret_UNK;
+    }
+
+    // reference counts on variables, the PO is kept until the chunk ends
+    std::vector<unsigned> ref_cts(this->max_var + 1, 0);
+    for (auto &gate : this->gates)
+    {
+        if (is_active(gate))
+        {
+            ref_cts[aiger_var(gate.inputs[0])]++;
+            ref_cts[aiger_var(gate.inputs[1])]++;
+        }
+    }
+    if (active == nullptr)
+        ref_cts[aiger_var(this->PO)]++;
+
+    // the chunk buffers, slot 0 is reserved for the constant
+    const unsigned NOT_ALLOC = UINT_MAX;
+    std::vector<bv_unit_t> pool(chunk_units, 0);
+    std::vector<unsigned> free_slots;
+    std::vector<unsigned> slot(this->max_var + 1, NOT_ALLOC);
+    std::vector<unsigned> remain(this->max_var + 1, 0);
+
+    auto alloc_slot = [&]() -> unsigned
+    {
+        if (free_slots.empty())
+        {
+            pool.resize(pool.size() + chunk_units);
+            return pool.size() / chunk_units - 1;
+        }
+        unsigned s = free_slots.back();
+        free_slots.pop_back();
+        return s;
+    };
+
+    auto release = [&](int var)
+    {
+        if (var == 0 || --remain[var] > 0)
+            return;
+        free_slots.push_back(slot[var]);
+        slot[var] = NOT_ALLOC;
+    };
+
+    slot[0] = 0;
+    for (uint64_t chunk = 0; chunk < n_chunks; chunk++)
+    {
+        for (int v = 1; v <= this->max_var; v++)
+            remain[v] = ref_cts[v];
+        absorb(0, pool.data(), chunk_units, chunk); // constant candidates
+
+        for (unsigned i = 0; i < this->PI.size(); i++)
+        {
+            int var = aiger_var(this->PI[i]);
+            if (active != nullptr && !(*active)[var])
+                continue;
+            slot[var] = alloc_slot();
+            bv_unit_t *data = pool.data() + slot[var] * chunk_units;
+            for (unsigned j = 0; j < chunk_units; j++)
+                data[j] = ResMgr::get().random_uint64();
+            absorb(var, data, chunk_units, chunk);
+            if (remain[var] == 0)
+            {
+                free_slots.push_back(slot[var]);
+                slot[var] = NOT_ALLOC;
+            }
+        }
+
+        for (auto &gate : this->gates)
+        {
+            if (!is_active(gate))
+                continue;
+
+            int var = aiger_var(gate.output);
+            int v0 = aiger_var(gate.inputs[0]);
+            int v1 = aiger_var(gate.inputs[1]);
+            slot[var] = alloc_slot();
+            // the pool may grow in alloc_slot, so take the pointers after it
+            bv_unit_t *out = pool.data() + slot[var] * chunk_units;
+            const bv_unit_t *in0 = pool.data() + slot[v0] * chunk_units;
+            const bv_unit_t *in1 = pool.data() + slot[v1] * chunk_units;
+            bv_unit_t neg0 = aiger_sign(gate.inputs[0]) ? ~0ull : 0ull;
+            bv_unit_t neg1 = aiger_sign(gate.inputs[1]) ? ~0ull : 0ull;
+
+            if (gate.type == fastLEC::GateType::AND2)
+            {
+                for (unsigned j = 0; j < chunk_units; j++)
+                    out[j] = (in0[j] ^ neg0) & (in1[j] ^ neg1);
+            }
+            else
+            {
+                for (unsigned j = 0; j < chunk_units; j++)
+                    out[j] = in0[j] ^ in1[j] ^ neg0 ^ neg1;
+            }
+            absorb(var, out, chunk_units, chunk);
+
+            release(v0);
+            release(v1);
+            if (remain[var] == 0)
+            {
+                free_slots.push_back(slot[var]);
+                slot[var] = NOT_ALLOC;
+            }
+        }
+
+        int po_var = aiger_var(this->PO);
+        if (active != nullptr || slot[po_var] == NOT_ALLOC)
+            continue;
+        const bv_unit_t *po = pool.data() + slot[po_var] * chunk_units;
+        bv_unit_t neg = aiger_sign(this->PO) ? ~0ull : 0ull;
+        bool hit = false;
+        for (unsigned j = 0; j < chunk_units; j++)
+            hit |= (po[j] ^ neg) != 0;
+        release(po_var);
+        if (hit)
+            return ret_vals::ret_SAT;
+    }
+
+    if (Param::get().verbose > 1)
+    {
+        printf("c [logSim] streaming %llu chunks, peak buffers: %zu KB\n",
+               (unsigned long long)n_chunks,
+               pool.size() * sizeof(bv_unit_t) / 1024);
+        fflush(stdout);
+    }
+
+    return ret_vals::ret_UNK;
+}
+
 bool fastLEC::XAG::check_XAG()
 {
     // Check max_var
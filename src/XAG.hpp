@@ -5,6 +5,7 @@
 #include <iostream>
 #include "AIG.hpp"
 #include "CNF.hpp"
+#include "basic.hpp"
 
 namespace fastLEC
 {
@@ -47,6 +48,31 @@ public:
     }
 };
 
+// the simulation signature of a node in the streaming simulation: a rolling
+// hash over all simulated words, plus a short raw prefix for collision checks
+struct SimSignature
+{
+    static const unsigned prefix_units = 2;
+
+    bool valid = false; // whether the node is simulated
+    // the signature is taken on the complement, so that the first pattern
+    // is always 0 and complemented nodes share one signature
+    bool phase = false;
+    uint64_t hash = 0;
+    uint64_t ones = 0; // number of ones among all the simulated patterns
+    bv_unit_t prefix[prefix_units] = {0, 0};
+
+    bool operator==(const SimSignature &rhs) const
+    {
+        if (hash != rhs.hash || ones != rhs.ones)
+            return false;
+        for (unsigned i = 0; i < prefix_units; i++)
+            if (prefix[i] != rhs.prefix[i])
+                return false;
+        return true;
+    }
+};
+
 class XAG
 {
     std::shared_ptr<fastLEC::CNF> cnf_backup;
@@ -89,12 +115,35 @@ public:
     void fast_compute_varcone_sizes(); // compute cone sizes for all variables
     bool strash_prune(unsigned a, unsigned b); // strash hashing matching
 
+    //---------------------------------------------------
+    // structural correspondence of the miter halves
+    //---------------------------------------------------
+    // the halves are the inputs of the XORs under the OR tree of the PO, the
+    // smaller variable on the first one. side (indexed by variable) gets 1
+    // in the cone of the first half, 2 in the second one, 3 in both. return
+    // false if the PO is not such a miter.
+    bool miter_halves(std::vector<char> &side) const;
+    // the local structural hashes of the nodes: hashes[0] of the type, the
+    // level and the fanout degree, hashes[d] also of the hashes[d - 1] of the
+    // fanins. the PIs are hashed by their variables, shared by the halves.
+    void structural_hashes(unsigned depth,
+                           std::vector<int> &level,
+                           std::vector<std::vector<uint64_t>> &hashes) const;
+
     //---------------------------------------------------
     // sub-graph extraction
     //---------------------------------------------------
+    // the materialized XAGView of the PO literals (one, or a pair to miter)
     std::shared_ptr<fastLEC::XAG>
     extract_sub_graph(const std::vector<int> vec_po);
 
+    // canonical form up to PI permutation and polarity: equal forms imply
+    // isomorphic XAGs. pi_label (indexed by variable) gets the canonical
+    // label (from 1) of each PI, pi_flip whether its polarity is flipped.
+    void canonical_form(std::vector<int> &form,
+                        std::vector<int> &pi_label,
+                        std::vector<bool> &pi_flip) const;
+
     //---------------------------------------------------
     // related to scores
     //---------------------------------------------------
@@ -103,6 +152,11 @@ public:
     void compute_XOR_chains(const std::vector<bool> &mask, // used nodes
                             std::vector<std::vector<int>> &XOR_chains,
                             std::vector<std::vector<int>> &important_nodes);
+    // the XOR chain of v over the unmasked nodes, v is not visited yet
+    void collect_XOR_chain(int v,
+                           const std::vector<bool> &mask,
+                           std::vector<bool> &visited,
+                           std::vector<int> &chain) const;
     void compute_distance(const std::vector<bool> &mask, // used nodes
                           std::vector<int> &in_degree,
                           std::vector<int> &out_degree,
@@ -115,6 +169,21 @@ public:
     void compute_simulation_features(std::vector<double> &one_percentages,
                                      std::vector<double> &entropys);
 
+    // simulate 2^n_bits random patterns, sigs (indexed by AIG variable) gets
+    // the signature of each simulated node. it runs the observing iES
+    // program, or (too wide for it) chunks of 2^chunk_bits bits where only
+    // the chunks with pending fanouts are kept alive. return ret_SAT if a
+    // pattern sets the PO. with active (indexed by var, closed under fanins)
+    // only the active nodes are simulated and the PO is not checked.
+    fastLEC::ret_vals stream_simulation(unsigned n_bits,
+                                        unsigned chunk_bits,
+                                        std::vector<SimSignature> &sigs,
+                                        const std::vector<bool> *active =
+                                            nullptr);
+    // the number of bits of patterns stream_simulation simulates for n_bits
+    // (at least one bv_unit_t)
+    static unsigned stream_bits(unsigned n_bits);
+
     void compute_n_step_XOR_cnt(const std::vector<bool> &mask,
                                 std::vector<std::vector<int>> &n_step_XOR_cnt,
                                 std::vector<std::vector<int>> &n_step_Gates_cnt,
@@ -123,10 +192,40 @@ public:
     // XAG useless variable elimination and remapping
     //---------------------------------------------------
     std::vector<int> var_replace;
+    // var v equals var_replace[v] complemented if var_replace_phase[v]
+    std::vector<bool> var_replace_phase;
     void init_var_replace();
-    void compact(); // TODO
+    // the literal of the representative (or constant) replacing lit
+    int replace_lit(int lit);
+    // merge the roots of two equivalent literals, the larger variable is
+    // replaced by the smaller one (the constant is always a root). return
+    // the replaced variable, 0 if they are already merged.
+    int merge_lits(int x, int y);
+
+    // the speculatively reduced model of the candidate pairs: the fanouts of
+    // a merged node use its representative, while the node keeps its own gate
+    // over the reduced fanins and a miter against the representative. the PO
+    // is the OR of all the miters (nullptr if there is no miter).
+    std::shared_ptr<fastLEC::XAG>
+    speculative_reduction(const std::vector<std::vector<int>> &pairs);
+
+    // the windowed ODC miter of replacing var by the literal rep: the window
+    // (the TFO of var in topological order, var included) is copied with var
+    // replaced by rep, the PO is the OR of the differences on the outputs
+    // (the window nodes observed out of it). UNSAT means that var can be
+    // merged to rep.
+    std::shared_ptr<fastLEC::XAG>
+    extract_odc_miter(int var,
+                      int rep,
+                      const std::vector<int> &window,
+                      const std::vector<int> &outputs);
+    // rebuild this XAG with the merges of var_replace applied: the constants
+    // are propagated, the structurally equal gates are hashed together and
+    // the dangling ones are removed. the PIs keep their variables.
+    void compact();
 
-    std::vector<int> father_var_mapper;
+    // the variable in the father XAG of each sub-XAG variable (increasing,
+    // -1 for the constant and the miter gate at the tail)
     std::vector<int> son_var_mapper;
     std::vector<int> mp_xag_to_aig_var; // used to xag->aiger
 
@@ -148,7 +247,59 @@ public:
     bool check_XAG();
 };
 
+// A read-only view of a cone of the parent XAG.
+// ----------------------------------------------------------------------------
+// the cone of the PO literals (one, or the XOR miter of a pair) is indexed
+// locally from 1 in topological order, the gate types stay in the parent.
+// the fanins are resolved through var_replace at the construction (under the
+// lock of the merges), the constants are folded lazily on the first access.
+// the view lives while the parent is not rebuilt.
+class XAGView
+{
+    fastLEC::XAG &parent;
+    std::vector<int> cone;   // local variable -> parent variable (0: miter)
+    std::vector<int> fanins; // the two local fanin literals per variable
+    int po;
+    mutable std::vector<int> folded; // local literal -> folded, -1: not yet
+
+public:
+    XAGView(fastLEC::XAG &parent, std::vector<int> vec_po);
+
+    int size() const { return cone.size() - 1; }
+    int parent_var(int v) const { return cone[v]; }
+    fastLEC::GateType type(int v) const;
+    int fanin(int v, int i) const { return fanins[2 * v + i]; }
+    // the literal that lit folds into: a constant, another literal of the
+    // view, or itself
+    int fold(int lit) const;
+    // whether v is a gate that is not folded
+    bool is_gate(int v) const
+    {
+        fastLEC::GateType t = type(v);
+        return (t == GateType::AND2 || t == GateType::XOR2) &&
+            fold(aiger_pos_lit(v)) == aiger_pos_lit(v);
+    }
+    int PO() const { return fold(po); }
+
+    // the compact sub-XAG of the used cone, son_var_mapper gives the parent
+    // variables
+    std::shared_ptr<fastLEC::XAG> materialize() const;
+};
+
 } // namespace fastLEC
 
+namespace std
+{
+
+template <> struct hash<fastLEC::SimSignature>
+{
+    size_t operator()(const fastLEC::SimSignature &sig) const
+    {
+        return sig.hash ^ (sig.prefix[0] + 0x9e3779b9 + (sig.hash << 6));
+    };
+};
+
+} // namespace std
+
 std::ostream &operator<<(std::ostream &os, const fastLEC::Gate &gate);
 std::ostream &operator<<(std::ostream &os, const fastLEC::XAG &xag);
\ No newline at end of file
@@ -141,6 +141,17 @@ public:
 
 void check_dir_and_create(const std::string &file_dir);
 
+// 64-bit finalizer of splitmix64
+inline uint64_t mix64(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
 } // namespace fastLEC
 
 namespace std
@@ -36,7 +36,8 @@ extern "C" int mycheckhook(DdManager *dd, const char *where, void *f)
 
     // Check global termination flag
     if (global_solved_for_PPE.load() ||
-        fastLEC::ResMgr::get().get_runtime() > fastLEC::Param::get().timeout)
+        fastLEC::ResMgr::get().get_runtime() >
+            fastLEC::Param::get().time_limit())
     {
         // Return 0 to terminate the operation (hook semantics: 0 = stop)
         return 0;
@@ -57,7 +58,8 @@ extern "C" int myterminationcallback(const void *arg)
 
     // Check global termination flag
     if (global_solved_for_PPE.load() ||
-        fastLEC::ResMgr::get().get_runtime() > fastLEC::Param::get().timeout)
+        fastLEC::ResMgr::get().get_runtime() >
+            fastLEC::Param::get().time_limit())
     {
         // Return 1 (true) to terminate the operation
         return 1;
@@ -181,7 +183,7 @@ fastLEC::Prover::seq_BDD_cudd(std::shared_ptr<fastLEC::XAG> xag)
 
         // Final check: timeout or terminated by other thread
         double final_time = fastLEC::ResMgr::get().get_runtime();
-        bool actual_timeout = final_time > Param::get().timeout;
+        bool actual_timeout = final_time > Param::get().time_limit();
 
         if (manager->hasTermination())
         {
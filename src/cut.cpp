@@ -0,0 +1,266 @@
+#include "cut.hpp"
+
+#include <algorithm>
+
+using namespace fastLEC;
+
+// the truth tables of the leaves 0..5 in a word, the leaves 6, 7 select words
+static const uint64_t var_masks[6] = {0xAAAAAAAAAAAAAAAAull,
+                                      0xCCCCCCCCCCCCCCCCull,
+                                      0xF0F0F0F0F0F0F0F0ull,
+                                      0xFF00FF00FF00FF00ull,
+                                      0xFFFF0000FFFF0000ull,
+                                      0xFFFFFFFF00000000ull};
+
+// the bits kept, moved up and moved down by swapping the variables v, v + 1
+static const uint64_t swap_masks[5][3] = {
+    {0x9999999999999999ull, 0x2222222222222222ull, 0x4444444444444444ull},
+    {0xC3C3C3C3C3C3C3C3ull, 0x0C0C0C0C0C0C0C0Cull, 0x3030303030303030ull},
+    {0xF00FF00FF00FF00Full, 0x00F000F000F000F0ull, 0x0F000F000F000F00ull},
+    {0xFF0000FFFF0000FFull, 0x0000FF000000FF00ull, 0x00FF000000FF0000ull},
+    {0xFFFF00000000FFFFull, 0x00000000FFFF0000ull, 0x0000FFFF00000000ull}};
+
+static void swap_adjacent(uint64_t *tt, unsigned n_words, unsigned v)
+{
+    if (v < 5)
+    {
+        const uint64_t *m = swap_masks[v];
+        unsigned shift = 1u << v;
+        for (unsigned w = 0; w < n_words; w++)
+            tt[w] = (tt[w] & m[0]) | ((tt[w] & m[1]) << shift) |
+                ((tt[w] & m[2]) >> shift);
+    }
+    else if (v == 5)
+    {
+        for (unsigned w = 0; w < n_words; w += 2)
+        {
+            uint64_t lo = tt[w], hi = tt[w + 1];
+            tt[w] = (lo & 0x00000000FFFFFFFFull) | (hi << 32);
+            tt[w + 1] = (lo >> 32) | (hi & 0xFFFFFFFF00000000ull);
+        }
+    }
+    else
+    {
+        unsigned step = 1u << (v - 6);
+        for (unsigned w = 0; w < n_words; w += 4 * step)
+            for (unsigned j = 0; j < step; j++)
+                std::swap(tt[w + step + j], tt[w + 2 * step + j]);
+    }
+}
+
+// move the variables of tt over the leaves of from to their positions in
+// the leaves of to (from is a subset of to)
+static void expand(uint64_t *tt,
+                   unsigned n_words,
+                   const CutEngine::Cut &from,
+                   const CutEngine::Cut &to)
+{
+    unsigned pos[CutEngine::max_leaves];
+    for (unsigned i = 0, j = 0; i < from.size; i++, j++)
+    {
+        while (to.leaves[j] != from.leaves[i])
+            j++;
+        pos[i] = j;
+    }
+    for (int i = (int)from.size - 1; i >= 0; i--)
+        for (unsigned v = i; v < pos[i]; v++)
+            swap_adjacent(tt, n_words, v);
+}
+
+// the sorted union of the leaves, false if it has more than k leaves
+static bool merge_leaves(const CutEngine::Cut &a,
+                         const CutEngine::Cut &b,
+                         unsigned k,
+                         CutEngine::Cut &cut)
+{
+    unsigned i = 0, j = 0, n = 0;
+    while (i < a.size || j < b.size)
+    {
+        if (n == k)
+            return false;
+        if (j == b.size || (i < a.size && a.leaves[i] < b.leaves[j]))
+            cut.leaves[n++] = a.leaves[i++];
+        else if (i == a.size || b.leaves[j] < a.leaves[i])
+            cut.leaves[n++] = b.leaves[j++];
+        else
+        {
+            cut.leaves[n++] = a.leaves[i++];
+            j++;
+        }
+    }
+    cut.size = n;
+    cut.sign = a.sign | b.sign;
+    return true;
+}
+
+static bool is_subset(const CutEngine::Cut &sub, const CutEngine::Cut &cut)
+{
+    if (sub.size > cut.size || (sub.sign & ~cut.sign) != 0)
+        return false;
+    for (unsigned i = 0, j = 0; i < sub.size; i++, j++)
+    {
+        while (j < cut.size && cut.leaves[j] < sub.leaves[i])
+            j++;
+        if (j == cut.size || cut.leaves[j] != sub.leaves[i])
+            return false;
+    }
+    return true;
+}
+
+CutEngine::CutEngine(const fastLEC::XAG &xag, unsigned k, unsigned max_cuts)
+    : xag(xag), k(std::min(std::max(k, 2u), max_leaves)), max_cuts(max_cuts)
+{
+    n_words = this->k <= 6 ? 1 : 1u << (this->k - 6);
+    cuts.resize(xag.max_var + 1);
+    level.assign(xag.max_var + 1, 0);
+}
+
+void CutEngine::trivial_cut(int var, Cut &cut) const
+{
+    cut.size = 1;
+    cut.leaves[0] = var;
+    cut.sign = 1ull << (var & 63);
+    for (unsigned w = 0; w < n_words; w++)
+        cut.tt[w] = var_masks[0];
+}
+
+void CutEngine::compute(int var)
+{
+    std::vector<Cut> &res = cuts[var];
+    res.clear();
+    if (var == 0)
+    {
+        // the constant 0, over no leaf
+        Cut cut;
+        for (unsigned w = 0; w < n_words; w++)
+            cut.tt[w] = 0;
+        res.push_back(cut);
+        return;
+    }
+
+    const Gate &gate = xag.gates[var];
+    if (gate.type == GateType::AND2 || gate.type == GateType::XOR2)
+    {
+        level[var] = 1 + std::max(level[aiger_var(gate.inputs[0])],
+                                  level[aiger_var(gate.inputs[1])]);
+        const std::vector<Cut> &cuts0 = cuts[aiger_var(gate.inputs[0])];
+        const std::vector<Cut> &cuts1 = cuts[aiger_var(gate.inputs[1])];
+
+        struct Candidate
+        {
+            Cut cut;
+            const Cut *c0, *c1;
+        };
+        std::vector<Candidate> candidates;
+        candidates.reserve(cuts0.size() * cuts1.size());
+        for (const Cut &c0 : cuts0)
+        {
+            for (const Cut &c1 : cuts1)
+            {
+                Candidate cand;
+                if ((unsigned)__builtin_popcountll(c0.sign | c1.sign) > k ||
+                    !merge_leaves(c0, c1, k, cand.cut))
+                    continue;
+                cand.c0 = &c0;
+                cand.c1 = &c1;
+                candidates.push_back(cand);
+            }
+        }
+        // the leaves near the PIs are more likely shared by the two sides
+        // of the miter, then the smaller cuts are preferred
+        auto cost = [&](const Cut &cut)
+        {
+            unsigned sum = 0;
+            for (unsigned i = 0; i < cut.size; i++)
+                sum += level[cut.leaves[i]];
+            return sum * 16 + cut.size;
+        };
+        std::stable_sort(candidates.begin(),
+                         candidates.end(),
+                         [&](const Candidate &a, const Candidate &b)
+                         {
+                             return cost(a.cut) < cost(b.cut);
+                         });
+
+        // a dominating cut has lower cost, so it is kept before
+        uint64_t m0 = aiger_sign(gate.inputs[0]) ? ~0ull : 0;
+        uint64_t m1 = aiger_sign(gate.inputs[1]) ? ~0ull : 0;
+        for (Candidate &cand : candidates)
+        {
+            if (res.size() == max_cuts)
+                break;
+            bool dominated = false;
+            for (const Cut &cut : res)
+                if ((dominated = is_subset(cut, cand.cut)))
+                    break;
+            if (dominated)
+                continue;
+
+            Cut &cut = cand.cut;
+            uint64_t tt0[4], tt1[4];
+            std::copy(cand.c0->tt, cand.c0->tt + n_words, tt0);
+            std::copy(cand.c1->tt, cand.c1->tt + n_words, tt1);
+            expand(tt0, n_words, *cand.c0, cut);
+            expand(tt1, n_words, *cand.c1, cut);
+            for (unsigned w = 0; w < n_words; w++)
+            {
+                if (gate.type == GateType::AND2)
+                    cut.tt[w] = (tt0[w] ^ m0) & (tt1[w] ^ m1);
+                else
+                    cut.tt[w] = tt0[w] ^ tt1[w] ^ m0 ^ m1;
+            }
+            res.push_back(cut);
+        }
+    }
+
+    // the PIs (and the unknown nodes) are only their own leaves
+    Cut cut;
+    trivial_cut(var, cut);
+    res.push_back(cut);
+}
+
+void CutEngine::substitute(int var, int rep)
+{
+    cuts[var] = cuts[aiger_var(rep)];
+    level[var] = level[aiger_var(rep)];
+    if (aiger_sign(rep))
+        for (Cut &cut : cuts[var])
+            for (unsigned w = 0; w < n_words; w++)
+                cut.tt[w] = ~cut.tt[w];
+}
+
+bool CutEngine::equal(int a, int b) const
+{
+    uint64_t phase = aiger_sign(a) ^ aiger_sign(b) ? ~0ull : 0;
+    auto same_tt = [&](const Cut &ca, const Cut &cb)
+    {
+        for (unsigned w = 0; w < n_words; w++)
+            if ((ca.tt[w] ^ cb.tt[w]) != phase)
+                return false;
+        return true;
+    };
+
+    if (aiger_var(a) == 0 || aiger_var(b) == 0)
+    {
+        // a constant cut function over any leaves
+        const Cut &zero = cuts[0][0];
+        for (const Cut &cut : cuts[aiger_var(a) == 0 ? aiger_var(b)
+                                                      : aiger_var(a)])
+            if (same_tt(zero, cut))
+                return true;
+        return false;
+    }
+
+    for (const Cut &ca : cuts[aiger_var(a)])
+    {
+        for (const Cut &cb : cuts[aiger_var(b)])
+        {
+            if (ca.size != cb.size || ca.sign != cb.sign ||
+                !std::equal(ca.leaves, ca.leaves + ca.size, cb.leaves))
+                continue;
+            if (same_tt(ca, cb))
+                return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "XAG.hpp"
+#include "basic.hpp"
+
+namespace fastLEC
+{
+
+// k-feasible priority cuts with truth tables.
+// ----------------------------------------------------------------------------
+// the cuts are computed bottom-up, one node at a time: the cuts of a gate are
+// the merges of the cuts of its fanins, the max_cuts non-dominated ones with
+// the lowest leaf levels are kept, plus the trivial cut. a truth table has
+// 2^k bits (one word up to 6 leaves, four words for 8), leaf i is the i-th
+// variable. two literals sharing a cut with equal (or complemented) truth
+// tables are equivalent, which needs no solver call.
+class CutEngine
+{
+public:
+    static const unsigned max_leaves = 8;
+
+    struct Cut
+    {
+        unsigned size = 0;
+        int leaves[max_leaves]; // the leaf variables, ascending
+        uint64_t sign = 0;      // one bit per leaf, for the subset checks
+        uint64_t tt[4];
+    };
+
+    CutEngine(const fastLEC::XAG &xag, unsigned k, unsigned max_cuts);
+
+    // compute the cuts of var, after the ones of its fanins
+    void compute(int var);
+    // var is proven to be equal to the literal rep (var(rep) < var): var
+    // takes the cuts of rep, so that its fanouts see the shared leaves
+    void substitute(int var, int rep);
+    // whether the literals a and b are equal over a common cut
+    bool equal(int a, int b) const;
+
+private:
+    const fastLEC::XAG &xag;
+    unsigned k, max_cuts;
+    unsigned n_words;
+    std::vector<std::vector<Cut>> cuts; // indexed by variable
+    std::vector<unsigned> level;        // the logic level of a variable
+
+    void trivial_cut(int var, Cut &cut) const;
+};
+
+} // namespace fastLEC
@@ -2,7 +2,11 @@
 #include "parser.hpp"
 #include "basic.hpp"
 #include "pSAT.hpp"
+#include "mpi_pSAT.hpp"
+#include "proof_cache.hpp"
 
+#include <climits>
+#include <cmath>
 #include <cstddef>
 #include <cstdio>
 #include <memory>
@@ -102,6 +106,7 @@ fastLEC::ret_vals Prover::check_cec()
     if (Param::get().mode == Mode::ES || Param::get().mode == Mode::pES ||
         Param::get().mode == Mode::gpuES || // all the ES modes
         Param::get().mode == Mode::BDD || Param::get().mode == Mode::pBDD ||
+        Param::get().mode == Mode::mpi_pSAT ||
         Param::get().mode >= Mode::SAT_sweeping) // all the sweeping modes
     {
         bool b_res = fm.aig_to_xag();
@@ -137,6 +142,9 @@ fastLEC::ret_vals Prover::check_cec()
             case Mode::gpuES:
                 ret = gpu_ES(xag);
                 break;
+            case Mode::mpi_pSAT:
+                ret = para_SAT_mpi(xag, Param::get().n_threads);
+                break;
             default:
                 fprintf(stderr, "c [CEC] Error: Invalid mode\n");
                 return ret_vals::ret_UNK;
@@ -404,6 +412,19 @@ fastLEC::ret_vals Prover::para_SAT_pSAT(std::shared_ptr<fastLEC::XAG> xag,
     return ret;
 }
 
+fastLEC::ret_vals Prover::para_SAT_mpi(std::shared_ptr<fastLEC::XAG> xag,
+                                       int n_t)
+{
+    // PartitionSAT indexes the XAG by the CNF variables, as in the compacted
+    // cone of the PO. the other ranks are waiting for it in main.
+    xag->init_var_replace();
+    xag = MPIEnv::get().broadcast_xag(xag->extract_sub_graph({xag->PO}));
+
+    DistributedSAT ds(xag, static_cast<unsigned>(n_t));
+
+    return ds.check();
+}
+
 fastLEC::ret_vals
 fastLEC::Prover::para_portfolios(std::shared_ptr<fastLEC::XAG> xag, int n_t)
 {
@@ -530,101 +551,317 @@ fastLEC::Prover::para_portfolios(std::shared_ptr<fastLEC::XAG> xag, int n_t)
     return ret_portfolios;
 }
 
+BudgetScope::BudgetScope(size_t n_gates, unsigned attempt, bool enabled)
+{
+    const CustomParams &params = Param::get().custom_params;
+    if (!enabled || params.sw_budget <= 0)
+        return;
+
+    active = true;
+    double scale = std::pow(params.sw_budget_growth, attempt);
+    double slice = params.sw_budget * (1.0 + n_gates / 1000.0) * scale;
+    Param::get().budget_deadline = ResMgr::get().get_runtime() + slice;
+    Param::get().budget_conflicts =
+        (int)std::min<double>(INT_MAX, params.sw_conflicts * scale);
+}
+
+BudgetScope::~BudgetScope()
+{
+    if (!active)
+        return;
+    Param::get().budget_deadline = -1.0;
+    Param::get().budget_conflicts = 0;
+}
+
 fastLEC::ret_vals
-Prover::run_sweeping(std::shared_ptr<fastLEC::Sweeper> sweeper)
+Prover::prove_sub_graph(std::shared_ptr<fastLEC::XAG> sub_graph,
+                        std::string &engine,
+                        std::string &cex)
 {
     fastLEC::ret_vals ret = ret_vals::ret_UNK;
+    std::vector<int> model;
 
-    ret = sweeper->logic_simulation();
-    if (ret == ret_vals::ret_SAT)
-        return ret;
+    switch (Param::get().mode)
+    {
+    case Mode::hybrid_sweeping:
+    {
+        auto eng = select_one_engine_hybridCEC(sub_graph);
+        printf("c [Prover] Selected engine: %s for hybrid sweeping\n",
+               eng == fastLEC::engines::engine_seq_ES ? "ES" : "SAT");
+        if (eng == fastLEC::engines::engine_seq_ES)
+        {
+            ret = seq_ES(sub_graph);
+            engine = "ES";
+        }
+        else if (eng == fastLEC::engines::engine_seq_SAT)
+        {
+            ret = seq_SAT_kissat(sub_graph->construct_cnf_from_this_xag(),
+                                 &model);
+            engine = "SAT";
+        }
+        else
+            ret = ret_vals::ret_UNK;
+        break;
+    }
+    case Mode::p_hybrid_sweeping:
+    {
+        auto eng = select_one_engine_hybridCEC(sub_graph);
+        printf("c [Prover] Selected engine: %s for p-hybrid sweeping\n",
+               eng == fastLEC::engines::engine_seq_ES ? "pES" : "pSAT");
+        if (eng == fastLEC::engines::engine_seq_ES)
+        {
+            ret = para_ES(sub_graph, Param::get().n_threads);
+            engine = "pES";
+        }
+        else if (eng == fastLEC::engines::engine_seq_SAT)
+        {
+            ret = para_SAT_pSAT(sub_graph, Param::get().n_threads);
+            engine = "pSAT";
+        }
+        else
+            ret = ret_vals::ret_UNK;
+        break;
+    }
+    case Mode::SAT_sweeping:
+    {
+        std::shared_ptr<fastLEC::CNF> cnf =
+            sub_graph->construct_cnf_from_this_xag();
+        ret = seq_SAT_kissat(cnf, &model);
+        engine = "SAT";
+        break;
+    }
+    case Mode::BDD_sweeping:
+    {
+        ret = seq_BDD_cudd(sub_graph);
+        engine = "BDD";
+        break;
+    }
+    case Mode::pBDD_sweeping:
+    {
+        ret = para_BDD_sylvan(sub_graph, Param::get().n_threads);
+        engine = "pBDD";
+        break;
+    }
+    case Mode::pSAT_sweeping:
+    {
+        std::shared_ptr<fastLEC::CNF> cnf =
+            sub_graph->construct_cnf_from_this_xag();
+        ret = para_SAT_pSAT(sub_graph, Param::get().n_threads);
+        engine = "pSAT";
+        break;
+    }
+    case Mode::half_sweeping:
+    case Mode::schedule_sweeping:
+    case Mode::PPE_sweeping:
+    case Mode::gpu_sweeping:
+    {
+        ret = para_portfolios(sub_graph, Param::get().n_threads);
+        engine = "portfolio";
+        break;
+    }
+    default:
+        fprintf(stderr, "c [Prover] Error: Invalid mode\n");
+        return ret_vals::ret_UNK;
+        break;
+    }
 
-    std::shared_ptr<fastLEC::XAG> sub_graph = nullptr;
+    cex.clear();
+    if (ret == ret_vals::ret_SAT && !model.empty())
+    {
+        for (int pi : sub_graph->PI)
+        {
+            int v = sub_graph->to_cnf_var(aiger_var(pi));
+            cex.push_back(v > 0 && model[v] > 0 ? '1' : '0');
+        }
+    }
 
-    while ((sub_graph = sweeper->next_sub_graph()))
+    return ret;
+}
+
+fastLEC::ret_vals
+Prover::run_speculation(std::shared_ptr<fastLEC::Sweeper> sweeper)
+{
+    int max_rounds = Param::get().custom_params.sw_spec;
+    for (int round = 0; round < max_rounds; round++)
     {
+        std::shared_ptr<fastLEC::XAG> spec = sweeper->speculative_graph();
+        if (spec == nullptr)
+            break;
         if (Param::get().verbose > 0)
         {
-            printf("%s\n", sweeper->sub_graph_string.c_str());
+            printf("c [SpecRed] round %d: %zu gates, %zu PIs\n",
+                   round,
+                   spec->used_gates.size(),
+                   spec->PI.size());
             fflush(stdout);
         }
 
-        switch (Param::get().mode)
-        {
-        case Mode::hybrid_sweeping:
+        double start_time = fastLEC::ResMgr::get().get_runtime();
+        std::string engine, cex;
+        fastLEC::ret_vals ret;
         {
-            auto eng = select_one_engine_hybridCEC(sub_graph);
-            printf("c [Prover] Selected engine: %s for hybrid sweeping\n",
-                   eng == fastLEC::engines::engine_seq_ES ? "ES" : "SAT");
-            if (eng == fastLEC::engines::engine_seq_ES)
-                ret = seq_ES(sub_graph);
-            else if (eng == fastLEC::engines::engine_seq_SAT)
-                ret = seq_SAT_kissat(sub_graph->construct_cnf_from_this_xag());
-            else
-                ret = ret_vals::ret_UNK;
-            break;
+            BudgetScope budget(spec->used_gates.size(), 0);
+            ret = prove_sub_graph(spec, engine, cex);
         }
-        case Mode::p_hybrid_sweeping:
+
+        if (ret == ret_vals::ret_UNS)
         {
-            auto eng = select_one_engine_hybridCEC(sub_graph);
-            printf("c [Prover] Selected engine: %s for p-hybrid sweeping\n",
-                   eng == fastLEC::engines::engine_seq_ES ? "pES" : "pSAT");
-            if (eng == fastLEC::engines::engine_seq_ES)
-                ret = para_ES(sub_graph, Param::get().n_threads);
-            else if (eng == fastLEC::engines::engine_seq_SAT)
-                ret = para_SAT_pSAT(sub_graph, Param::get().n_threads);
-            else
-                ret = ret_vals::ret_UNK;
+            sweeper->commit_speculation();
+            printf("c [SpecRed] round %d: all the candidates are proven by "
+                   "%s [time = %.2f]\n",
+                   round,
+                   engine.c_str(),
+                   fastLEC::ResMgr::get().get_runtime() - start_time);
+            fflush(stdout);
             break;
         }
-        case Mode::SAT_sweeping:
+        if (ret != ret_vals::ret_SAT || cex.empty())
         {
-            std::shared_ptr<fastLEC::CNF> cnf =
-                sub_graph->construct_cnf_from_this_xag();
-            ret = seq_SAT_kissat(cnf);
+            // unsolved, or no counterexample to refine with
+            printf("c [SpecRed] round %d: %s, back to pairwise sweeping\n",
+                   round,
+                   ret == ret_vals::ret_SAT ? "no counterexample" : "unknown");
+            fflush(stdout);
             break;
         }
-        case Mode::BDD_sweeping:
+
+        unsigned n_dropped = 0;
+        if (sweeper->refine_speculation(cex, n_dropped) == ret_vals::ret_SAT)
         {
-            ret = seq_BDD_cudd(sub_graph);
-            break;
+            printf("c [SpecRed] round %d: Find bugs\n", round);
+            fflush(stdout);
+            return ret_vals::ret_SAT;
         }
-        case Mode::pBDD_sweeping:
+        if (Param::get().verbose > 0)
         {
-            ret = para_BDD_sylvan(sub_graph, Param::get().n_threads);
-            break;
+            printf("c [SpecRed] round %d: drop %u candidates [time = %.2f]\n",
+                   round,
+                   n_dropped,
+                   fastLEC::ResMgr::get().get_runtime() - start_time);
+            fflush(stdout);
         }
-        case Mode::pSAT_sweeping:
-        {
-            std::shared_ptr<fastLEC::CNF> cnf =
-                sub_graph->construct_cnf_from_this_xag();
-            ret = para_SAT_pSAT(sub_graph, Param::get().n_threads);
+        if (n_dropped == 0)
             break;
+    }
+    return ret_vals::ret_UNK;
+}
+
+void Prover::run_odc_merging(std::shared_ptr<fastLEC::Sweeper> sweeper)
+{
+    double start_time = fastLEC::ResMgr::get().get_runtime();
+    unsigned n_candidates = sweeper->compute_odc_candidates();
+    printf("c [ODC] %u candidates [time = %.2f]\n",
+           n_candidates,
+           fastLEC::ResMgr::get().get_runtime() - start_time);
+    fflush(stdout);
+
+    std::shared_ptr<fastLEC::XAG> miter = nullptr;
+    while ((miter = sweeper->next_odc_graph()))
+    {
+        if (Param::get().verbose > 0)
+        {
+            printf("%s\n", sweeper->sub_graph_string.c_str());
+            fflush(stdout);
         }
-        case Mode::half_sweeping:
+
+        std::string engine, cex;
+        fastLEC::ret_vals ret;
         {
-            ret = para_portfolios(sub_graph, Param::get().n_threads);
+            BudgetScope budget(miter->used_gates.size(), 0);
+            ret = prove_sub_graph(miter, engine, cex);
+        }
+
+        sweeper->post_odc_proof(ret);
+        if (fastLEC::ResMgr::get().get_runtime() >= Param::get().timeout)
             break;
+    }
+
+    printf("c [ODC] merged %u / %u candidates [time = %.2f]\n",
+           sweeper->n_odc_merged,
+           n_candidates,
+           fastLEC::ResMgr::get().get_runtime() - start_time);
+    fflush(stdout);
+}
+
+fastLEC::ret_vals Prover::sweep_pass(std::shared_ptr<fastLEC::Sweeper> sweeper,
+                                     ProofCache &cache)
+{
+    fastLEC::ret_vals ret = ret_vals::ret_UNK;
+    std::shared_ptr<fastLEC::XAG> sub_graph = nullptr;
+
+    while ((sub_graph = sweeper->next_sub_graph()))
+    {
+        if (Param::get().verbose > 0)
+        {
+            printf("%s\n", sweeper->sub_graph_string.c_str());
+            fflush(stdout);
         }
-        case Mode::schedule_sweeping:
+
+        std::string cex;
+        auto iso = sweeper->match_isomorphic(sub_graph, ret, cex);
+        if (iso == Sweeper::iso_solved)
         {
-            ret = para_portfolios(sub_graph, Param::get().n_threads);
-            break;
+            if (Param::get().verbose > 0)
+            {
+                printf("c [Sweeper] reuse isomorphic sub-graph: %s\n",
+                       ret == ret_vals::ret_UNS ? "EQ" : "NEQ");
+                fflush(stdout);
+            }
+            sweeper->post_proof(ret);
+            continue;
         }
-        case Mode::PPE_sweeping:
+
+        bool budgeted = Param::get().custom_params.sw_budget > 0 &&
+            !sweeper->is_final_sub_graph();
+
+        CacheKey key;
+        CacheEntry entry;
+        if (cache.is_open())
+            key = ProofCache::key_of(*sub_graph);
+
+        if (cache.is_open() && cache.lookup(key, entry))
         {
-            ret = para_portfolios(sub_graph, Param::get().n_threads);
-            break;
+            ret = entry.result;
+            if (Param::get().verbose > 0)
+            {
+                printf("c [ProofCache] hit: %s by %s (%.2f s)\n",
+                       ret == ret_vals::ret_UNS ? "EQ" : "NEQ",
+                       entry.engine.c_str(),
+                       entry.time);
+                fflush(stdout);
+            }
         }
-        case Mode::gpu_sweeping:
+        else
         {
-            ret = para_portfolios(sub_graph, Param::get().n_threads);
-            break;
+            double start_time = fastLEC::ResMgr::get().get_runtime();
+            {
+                // the time slice grows with the sub-graph size and retries
+                BudgetScope budget(
+                    sub_graph->used_gates.size(), sweeper->attempt(), budgeted);
+                ret = prove_sub_graph(sub_graph, entry.engine, entry.cex);
+            }
+
+            if (cache.is_open() && ret != ret_vals::ret_UNK)
+            {
+                entry.result = ret;
+                entry.time = fastLEC::ResMgr::get().get_runtime() - start_time;
+                cache.store(key, entry);
+            }
         }
-        default:
-            fprintf(stderr, "c [Prover] Error: Invalid mode\n");
-            return ret_vals::ret_UNK;
-            break;
+        sweeper->record_isomorphic(ret, entry.cex);
+
+        if (budgeted && ret == ret_vals::ret_UNK &&
+            fastLEC::ResMgr::get().get_runtime() < Param::get().timeout)
+        {
+            // out of budget: leave the pair unmerged and go on sweeping
+            bool deferred = sweeper->defer_last();
+            if (Param::get().verbose > 0)
+            {
+                printf("c [Sweeper] out of budget, %s\n",
+                       deferred ? "retry later" : "left unmerged");
+                fflush(stdout);
+            }
+            continue;
         }
 
         // ret = fast_aig_check(sub_graph->construct_aig_from_this_xag());
@@ -640,5 +877,76 @@ Prover::run_sweeping(std::shared_ptr<fastLEC::Sweeper> sweeper)
             break;
     }
 
+    return ret;
+}
+
+fastLEC::ret_vals
+Prover::run_sweeping(std::shared_ptr<fastLEC::Sweeper> sweeper)
+{
+    fastLEC::ret_vals ret = ret_vals::ret_UNK;
+
+    ProofCache cache;
+    if (!Param::get().custom_params.proof_cache.empty())
+        cache.open(Param::get().custom_params.proof_cache);
+
+    int max_passes = std::max(1, Param::get().custom_params.sw_passes);
+    for (int pass = 0;; pass++)
+    {
+        if (pass > 0)
+        {
+            ret = sweeper->reduce_graph(pass);
+            if (ret != ret_vals::ret_UNK)
+                break;
+        }
+
+        ret = sweeper->logic_simulation();
+        if (ret == ret_vals::ret_SAT)
+            return ret;
+
+        sweeper->cut_sweeping();
+
+        ret = run_speculation(sweeper);
+        if (ret == ret_vals::ret_SAT)
+            return ret;
+
+        bool more_passes = pass + 1 < max_passes;
+        sweeper->defer_final =
+            more_passes || Param::get().custom_params.sw_odc_levels > 0;
+        ret = sweep_pass(sweeper, cache);
+        if (!sweeper->final_deferred)
+            break;
+        if (fastLEC::ResMgr::get().get_runtime() >= Param::get().timeout)
+        {
+            ret = ret_vals::ret_UNK; // the final check is not reached
+            break;
+        }
+
+        if (Param::get().custom_params.sw_odc_levels > 0)
+            run_odc_merging(sweeper);
+        if (more_passes && sweeper->n_merges() > 0)
+            continue;
+
+        // the final check of this pass
+        sweeper->defer_final = false;
+        ret = sweep_pass(sweeper, cache);
+        break;
+    }
+
+    if (cache.is_open())
+        cache.print_stats();
+    if (Param::get().verbose > 0 && Param::get().custom_params.iso_reuse)
+    {
+        printf("c [Sweeper] isomorphic sub-graphs: %u reused\n",
+               sweeper->n_iso_reused);
+        fflush(stdout);
+    }
+    if (Param::get().verbose > 0 && Param::get().custom_params.sw_prefetch > 0)
+    {
+        printf("c [Sweeper] prepared sub-graphs: %u used, %u stale\n",
+               sweeper->n_prep_used,
+               sweeper->n_prep_stale);
+        fflush(stdout);
+    }
+
     return ret;
 }
\ No newline at end of file
@@ -15,6 +15,8 @@
 namespace fastLEC
 {
 
+class ProofCache;
+
 class FormatManager
 {
 private:
@@ -72,6 +74,21 @@ public:
     std::shared_ptr<fastLEC::CNF> get_cnf_shared() { return cnf; }
 };
 
+// the budget of a sweeping sub-problem while the scope lives: the engines
+// stop at Param::time_limit(), the sequential SAT solver also at the conflict
+// limit. the slice grows with the gates, and by sw_budget_growth with the
+// attempt. nothing is set if sw_budget is 0 or the scope is disabled.
+class BudgetScope
+{
+    bool active = false;
+
+public:
+    BudgetScope(size_t n_gates, unsigned attempt, bool enabled = true);
+    ~BudgetScope();
+    BudgetScope(const BudgetScope &) = delete;
+    BudgetScope &operator=(const BudgetScope &) = delete;
+};
+
 class Prover
 {
 private:
@@ -96,11 +113,16 @@ public:
     // check const output of AIG
     fastLEC::ret_vals fast_aig_check(std::shared_ptr<fastLEC::AIG> aig);
 
-    // using SAT solvers to solve CNF
-    fastLEC::ret_vals seq_SAT_kissat(std::shared_ptr<fastLEC::CNF> cnf);
+    // using SAT solvers to solve CNF, model[v] gets the value (+-v) of each
+    // CNF variable v if it is SAT
+    fastLEC::ret_vals seq_SAT_kissat(std::shared_ptr<fastLEC::CNF> cnf,
+                                     std::vector<int> *model = nullptr);
     // using pSAT solvers to solve XAG
     fastLEC::ret_vals para_SAT_pSAT(std::shared_ptr<fastLEC::XAG> xag,
                                     int n_t = 1);
+    // using pSAT solvers on all the MPI ranks to solve XAG (rank 0)
+    fastLEC::ret_vals para_SAT_mpi(std::shared_ptr<fastLEC::XAG> xag,
+                                   int n_t = 1);
 
     // using BDDs for XAG
     fastLEC::ret_vals seq_BDD_cudd(std::shared_ptr<fastLEC::XAG> xag);
@@ -114,6 +136,21 @@ public:
 
     // sweeping engine for CEC
     fastLEC::ret_vals run_sweeping(std::shared_ptr<fastLEC::Sweeper> sweeper);
+    // merge the nodes with their ODC candidates proven on windowed miters
+    void run_odc_merging(std::shared_ptr<fastLEC::Sweeper> sweeper);
+    // prove the sub-graphs of one sweeping pass
+    fastLEC::ret_vals sweep_pass(std::shared_ptr<fastLEC::Sweeper> sweeper,
+                                 fastLEC::ProofCache &cache);
+    // prove all the candidate pairs at once in speculatively reduced models,
+    // refined by the counterexamples, before the pairwise sweeping
+    fastLEC::ret_vals
+    run_speculation(std::shared_ptr<fastLEC::Sweeper> sweeper);
+    // prove a sweeping sub-graph with the engine(s) of the current mode,
+    // engine gets the name of the used engine, cex gets the PI values of a
+    // counterexample if the used engine provides one
+    fastLEC::ret_vals prove_sub_graph(std::shared_ptr<fastLEC::XAG> sub_graph,
+                                      std::string &engine,
+                                      std::string &cex);
 
     // portfolio engines for CEC
     fastLEC::ret_vals para_portfolios(std::shared_ptr<fastLEC::XAG> xag,
@@ -23,11 +23,13 @@ extern "C"
     // the operation type
     typedef enum op_type
     {
-        OP_AND, // OP_AND addr1 addr2 addr3 : mem[addr1] <- mem[addr2] &
-                // mem[addr3]
-        OP_XOR, // OP_XOR addr1 addr2 addr3 : mem[addr1] <- mem[addr2] ^
-                // mem[addr3]
-        OP_NOT, // OP_NOT addr1 addr2 : mem[addr1] <- ~mem[addr2]
+        OP_AND,  // OP_AND addr1 addr2 addr3 : mem[addr1] <- mem[addr2] &
+                 // mem[addr3]
+        OP_XOR,  // OP_XOR addr1 addr2 addr3 : mem[addr1] <- mem[addr2] ^
+                 // mem[addr3]
+        OP_NOT,  // OP_NOT addr1 addr2 : mem[addr1] <- ~mem[addr2]
+        OP_SAVE, // OP_SAVE addr2 : obs[k] <- mem[addr2], the k-th OP_SAVE
+                 // (only in the observing programs, see run_observe)
     } op_type;
 
     // the longest circuit width should not longer than 2^16.
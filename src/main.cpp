@@ -1,4 +1,5 @@
 #include "fastLEC.hpp"
+#include "mpi_pSAT.hpp"
 #include "parser.hpp"
 #include <iostream>
 
@@ -18,12 +19,27 @@ int main(int argc, char *argv[])
             fastLEC::Param::get().mode = fastLEC::Mode::SAT_sweeping;
         }
 
+        // mpi_pSAT: only rank 0 reads the miter, the other ranks get its XAG
+        if (fastLEC::Param::get().mode == fastLEC::Mode::mpi_pSAT &&
+            fastLEC::MPIEnv::get().init(&argc, &argv) &&
+            fastLEC::MPIEnv::get().rank() != 0)
+        {
+            std::shared_ptr<fastLEC::XAG> xag =
+                fastLEC::MPIEnv::get().broadcast_xag(nullptr);
+            if (xag)
+                fastLEC::DistributedSAT(xag, fastLEC::Param::get().n_threads)
+                    .check();
+            fastLEC::MPIEnv::get().finalize();
+            return 0;
+        }
+
         fastLEC::Prover prover;
 
         bool ret = prover.read_aiger();
         if (!ret)
         {
             std::cout << "c [Main] Failed to build AIGER netlist" << std::endl;
+            fastLEC::MPIEnv::get().finalize();
             return 1;
         }
 
@@ -45,6 +61,7 @@ int main(int argc, char *argv[])
         std::cout << "c Runtime: " << fastLEC::ResMgr::get().get_runtime()
                   << " seconds" << std::endl;
 
+        fastLEC::MPIEnv::get().finalize();
         return 0;
     }
     catch (const std::exception &e)
@@ -0,0 +1,478 @@
+#include "mpi_pSAT.hpp"
+#include "parser.hpp"
+
+#include <chrono>
+#include <cstdio>
+
+using namespace fastLEC;
+
+// the message tags, the payloads are int vectors
+enum mpi_tags
+{
+    TAG_STEAL = 1, // thief -> victim: {0}
+    TAG_WORK,      // victim -> thief: {gen, task id, cube...}
+    TAG_NO_WORK,   // victim -> thief: {0}
+    TAG_RESULT,    // thief -> victim: {gen, task id, result}
+    TAG_CANCEL,    // victim -> thief: {gen, task id}
+    TAG_SAT,       // any rank -> rank 0: {0}
+    TAG_STOP,      // rank 0 -> any rank: {result}
+};
+
+// the pause of a thief after a failed steal, in seconds
+static const double steal_backoff = 0.005;
+
+// ----------------------------------------------------------------------------
+// XAG serialization
+// ----------------------------------------------------------------------------
+// {max_var, num_PIs_org, PO, |PI|, |used_gates|}, the PIs, three words per
+// used gate {output << 1 | is XOR, input 0, input 1}, then used_lits as bits.
+// the derived data is rebuilt by the receivers as from the AIG.
+#ifdef FASTLEC_MPI
+
+static void pack_xag(const fastLEC::XAG &xag, std::vector<int> &buf)
+{
+    buf = {xag.max_var,
+           xag.num_PIs_org,
+           xag.PO,
+           (int)xag.PI.size(),
+           (int)xag.used_gates.size()};
+    buf.insert(buf.end(), xag.PI.begin(), xag.PI.end());
+    for (int v : xag.used_gates)
+    {
+        const Gate &g = xag.gates[v];
+        buf.push_back(g.output << 1 | (g.type == GateType::XOR2));
+        buf.push_back(g.inputs[0]);
+        buf.push_back(g.inputs[1]);
+    }
+    std::vector<uint32_t> bits((xag.used_lits.size() + 31) / 32, 0);
+    for (unsigned l = 0; l < xag.used_lits.size(); l++)
+        if (xag.used_lits[l])
+            bits[l / 32] |= 1u << (l % 32);
+    for (uint32_t w : bits)
+        buf.push_back((int)w);
+}
+
+static std::shared_ptr<fastLEC::XAG> unpack_xag(const std::vector<int> &buf)
+{
+    std::shared_ptr<fastLEC::XAG> xag = std::make_shared<fastLEC::XAG>();
+    unsigned pos = 0;
+    xag->max_var = buf[pos++];
+    xag->num_PIs_org = buf[pos++];
+    xag->PO = buf[pos++];
+    int n_PIs = buf[pos++];
+    int n_gates = buf[pos++];
+
+    xag->gates.resize(xag->max_var + 1);
+    for (int v = 1; v <= xag->max_var; v++)
+        xag->gates[v].output = aiger_pos_lit(v);
+    for (int i = 0; i < n_PIs; i++)
+    {
+        int lit = buf[pos++];
+        xag->PI.push_back(lit);
+        xag->gates[aiger_var(lit)].type = GateType::PI;
+    }
+    for (int i = 0; i < n_gates; i++)
+    {
+        int o = buf[pos] >> 1;
+        GateType type = (buf[pos] & 1) ? GateType::XOR2 : GateType::AND2;
+        xag->gates[aiger_var(o)].set(o, type, buf[pos + 1], buf[pos + 2]);
+        xag->used_gates.push_back(aiger_var(o));
+        pos += 3;
+    }
+    xag->used_lits.resize(2 * (xag->max_var + 1), false);
+    for (unsigned l = 0; l < xag->used_lits.size(); l++)
+        xag->used_lits[l] = ((uint32_t)buf[pos + l / 32] >> (l % 32)) & 1;
+    return xag;
+}
+
+#endif
+
+// ----------------------------------------------------------------------------
+// related to MPIEnv
+// ----------------------------------------------------------------------------
+
+MPIEnv &MPIEnv::get()
+{
+    static MPIEnv instance;
+    return instance;
+}
+
+bool MPIEnv::init(int *argc, char ***argv)
+{
+#ifdef FASTLEC_MPI
+    // only the main thread of a rank calls MPI
+    int provided = 0;
+    MPI_Init_thread(argc, argv, MPI_THREAD_FUNNELED, &provided);
+    MPI_Comm_rank(MPI_COMM_WORLD, &_rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &_size);
+    initialized = true;
+    if (provided < MPI_THREAD_FUNNELED && _rank == 0)
+        printf("c [mpi_pSAT] warning: MPI_THREAD_FUNNELED is not provided\n");
+    if (Param::get().verbose > 0 && _rank == 0)
+    {
+        printf("c [mpi_pSAT] %d ranks x %u threads\n",
+               _size,
+               Param::get().n_threads);
+        fflush(stdout);
+    }
+    return true;
+#else
+    (void)argc;
+    (void)argv;
+    printf("c [mpi_pSAT] built without MPI (USE_MPI_PSAT=OFF), "
+           "running a single process\n");
+    fflush(stdout);
+    return false;
+#endif
+}
+
+void MPIEnv::finalize()
+{
+#ifdef FASTLEC_MPI
+    if (!initialized)
+        return;
+    if (_rank == 0 && !miter_sent)
+        broadcast_xag(nullptr);
+    MPI_Finalize();
+    initialized = false;
+#endif
+}
+
+std::shared_ptr<fastLEC::XAG>
+MPIEnv::broadcast_xag(std::shared_ptr<fastLEC::XAG> xag)
+{
+#ifdef FASTLEC_MPI
+    if (!initialized)
+        return xag;
+
+    std::vector<int> buf;
+    if (_rank == 0)
+    {
+        miter_sent = true;
+        if (xag)
+            pack_xag(*xag, buf);
+    }
+    int n = buf.size();
+    MPI_Bcast(&n, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    buf.resize(n);
+    if (n > 0)
+        MPI_Bcast(buf.data(), n, MPI_INT, 0, MPI_COMM_WORLD);
+
+    if (_rank == 0)
+    {
+        if (Param::get().verbose > 0)
+        {
+            printf("c [mpi_pSAT] broadcast the XAG in %zu bytes\n",
+                   buf.size() * sizeof(int));
+            fflush(stdout);
+        }
+        return xag;
+    }
+    return n == 0 ? nullptr : unpack_xag(buf);
+#else
+    return xag;
+#endif
+}
+
+// ----------------------------------------------------------------------------
+// related to DistributedSAT
+// ----------------------------------------------------------------------------
+
+DistributedSAT::DistributedSAT(std::shared_ptr<fastLEC::XAG> xag,
+                               unsigned n_threads)
+    : xag(xag), n_threads(n_threads), rank(MPIEnv::get().rank()),
+      size(MPIEnv::get().size()), ps_done(false), ps_ret(ret_vals::ret_UNK),
+      gen(0), victim(-1), victim_gen(0), victim_task(ID_NONE),
+      cancelled(false)
+{
+}
+
+DistributedSAT::~DistributedSAT()
+{
+    if (ps)
+        ps->terminate_all_tasks();
+    if (solving.joinable())
+        solving.join();
+}
+
+ret_vals DistributedSAT::check()
+{
+    if (size == 1)
+    {
+        PartitionSAT local(xag, n_threads);
+        return local.check();
+    }
+
+#ifdef FASTLEC_MPI
+    double start_time = fastLEC::ResMgr::get().get_runtime();
+    if (rank == 0)
+        start({});
+
+    while (!stopping)
+    {
+        bool busy = handle_message();
+        flush_outbox();
+        if (ps && ps_done.load())
+        {
+            finish();
+            busy = true;
+        }
+        if (stopping)
+            break;
+        if (ps)
+            cancel_exported(true);
+
+        // rank 0 keeps the root, the others steal from a random rank
+        double now = fastLEC::ResMgr::get().get_runtime();
+        if (!ps && !stealing && rank != 0 && now >= next_steal)
+        {
+            int v = fastLEC::ResMgr::get().random_uint64() % (size - 1);
+            if (v >= rank)
+                v++;
+            send(v, TAG_STEAL, {0});
+            stealing = true;
+        }
+        if (!busy)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    shutdown();
+
+    if (Param::get().verbose > 0)
+    {
+        printf("c [mpi_pSAT] rank %d: stolen = %u, exported = %u, "
+               "failed steals = %u\n",
+               rank,
+               n_stolen,
+               n_exported,
+               n_steal_fails);
+        if (rank == 0)
+            printf("c [mpi_pSAT] result = %d [ranks = %d, threads = %u]"
+                   "[time = %.2f]\n",
+                   final_ret,
+                   size,
+                   n_threads,
+                   fastLEC::ResMgr::get().get_runtime() - start_time);
+        fflush(stdout);
+    }
+#endif
+    return final_ret;
+}
+
+void DistributedSAT::start(const std::vector<int> &cube)
+{
+    ps = std::make_unique<PartitionSAT>(xag, n_threads, cube);
+    ps_done.store(false);
+    cancelled = false;
+    solving = std::thread(
+        [this]()
+        {
+            ps_ret = ps->check();
+            ps_done.store(true);
+        });
+}
+
+#ifdef FASTLEC_MPI
+
+void DistributedSAT::finish()
+{
+    solving.join();
+    ret_vals ret = ps_ret;
+    // the exported tasks are covered by the result
+    cancel_exported(false);
+    ps.reset();
+    gen++;
+
+    if (rank == 0)
+    {
+        stop_all(ret);
+        return;
+    }
+    if (ret == ret_vals::ret_SAT)
+        send(0, TAG_SAT, {0});
+    if (!cancelled)
+        send(victim, TAG_RESULT, {victim_gen, victim_task, ret});
+
+    if (Param::get().verbose > 1)
+    {
+        printf("c [mpi_pSAT] rank %d: task %d of rank %d -> %d%s\n",
+               rank,
+               victim_task,
+               victim,
+               ret,
+               cancelled ? " (cancelled)" : "");
+        fflush(stdout);
+    }
+}
+
+void DistributedSAT::stop_all(ret_vals ret)
+{
+    final_ret = ret;
+    stopping = true;
+    for (int r = 1; r < size; r++)
+        send(r, TAG_STOP, {ret});
+}
+
+void DistributedSAT::cancel_exported(bool only_solved)
+{
+    for (auto it = exported.begin(); it != exported.end();)
+    {
+        // solved by a local propagation, or stopped
+        Task *task = ps->get_task_by_id(it->first);
+        if (only_solved && !task->is_solved() && !ps->is_stopped())
+        {
+            ++it;
+            continue;
+        }
+        send(it->second, TAG_CANCEL, {(int)gen, it->first});
+        it = exported.erase(it);
+    }
+}
+
+bool DistributedSAT::handle_message()
+{
+    int flag = 0;
+    MPI_Status status;
+    MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &flag, &status);
+    if (!flag)
+        return false;
+
+    int n = 0;
+    MPI_Get_count(&status, MPI_INT, &n);
+    std::vector<int> msg(n);
+    int src = status.MPI_SOURCE;
+    MPI_Recv(msg.data(),
+             n,
+             MPI_INT,
+             src,
+             status.MPI_TAG,
+             MPI_COMM_WORLD,
+             MPI_STATUS_IGNORE);
+    if (stopping)
+        return true; // drained, see shutdown()
+
+    switch (status.MPI_TAG)
+    {
+    case TAG_STEAL:
+    {
+        std::vector<int> cube;
+        int id = ps ? ps->export_task(cube) : ID_NONE;
+        if (id == ID_NONE)
+        {
+            send(src, TAG_NO_WORK, {0});
+            break;
+        }
+        exported[id] = src;
+        n_exported++;
+        std::vector<int> work = {(int)gen, id};
+        work.insert(work.end(), cube.begin(), cube.end());
+        send(src, TAG_WORK, std::move(work));
+        break;
+    }
+    case TAG_WORK:
+        stealing = false;
+        victim = src;
+        victim_gen = msg[0];
+        victim_task = msg[1];
+        n_stolen++;
+        start(std::vector<int>(msg.begin() + 2, msg.end()));
+        break;
+    case TAG_NO_WORK:
+        stealing = false;
+        n_steal_fails++;
+        next_steal = fastLEC::ResMgr::get().get_runtime() + steal_backoff;
+        break;
+    case TAG_RESULT:
+    {
+        // a result of an older generation is dropped
+        auto it = exported.find(msg[1]);
+        if (!ps || msg[0] != (int)gen || it == exported.end() ||
+            it->second != src)
+            break;
+        exported.erase(it);
+        ps->import_result(msg[1], static_cast<ret_vals>(msg[2]));
+        break;
+    }
+    case TAG_CANCEL:
+        if (ps && src == victim && msg[0] == victim_gen &&
+            msg[1] == victim_task)
+        {
+            cancelled = true;
+            ps->terminate_all_tasks();
+        }
+        break;
+    case TAG_SAT:
+        stop_all(ret_vals::ret_SAT);
+        break;
+    case TAG_STOP:
+        final_ret = static_cast<ret_vals>(msg[0]);
+        stopping = true;
+        break;
+    default:
+        break;
+    }
+    return true;
+}
+
+void DistributedSAT::send(int dest, int tag, std::vector<int> msg)
+{
+    outbox.emplace_back();
+    Outgoing &out = outbox.back();
+    out.buf = std::move(msg);
+    MPI_Issend(out.buf.data(),
+               out.buf.size(),
+               MPI_INT,
+               dest,
+               tag,
+               MPI_COMM_WORLD,
+               &out.req);
+}
+
+void DistributedSAT::flush_outbox()
+{
+    for (auto it = outbox.begin(); it != outbox.end();)
+    {
+        int done = 0;
+        MPI_Test(&it->req, &done, MPI_STATUS_IGNORE);
+        it = done ? outbox.erase(it) : std::next(it);
+    }
+}
+
+void DistributedSAT::shutdown()
+{
+    if (ps)
+    {
+        ps->terminate_all_tasks();
+        solving.join();
+        ps.reset();
+    }
+
+    // a synchronous send is complete once it is received: when all the
+    // ranks reach the barrier with an empty outbox, no message is in flight
+    auto drain = [this]()
+    {
+        if (!handle_message())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        flush_outbox();
+    };
+    while (!outbox.empty())
+        drain();
+    MPI_Request barrier;
+    MPI_Ibarrier(MPI_COMM_WORLD, &barrier);
+    int done = 0;
+    while (!done)
+    {
+        drain();
+        MPI_Test(&barrier, &done, MPI_STATUS_IGNORE);
+    }
+}
+
+#else
+
+// a single rank does not leave the local PartitionSAT of check()
+void DistributedSAT::finish() {}
+void DistributedSAT::stop_all(ret_vals) {}
+void DistributedSAT::cancel_exported(bool) {}
+bool DistributedSAT::handle_message() { return false; }
+void DistributedSAT::shutdown() {}
+
+#endif
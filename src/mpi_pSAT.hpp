@@ -0,0 +1,120 @@
+#pragma once
+
+#include <list>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <unordered_map>
+
+#include "XAG.hpp"
+#include "basic.hpp"
+#include "pSAT.hpp"
+
+#ifdef FASTLEC_MPI
+#include <mpi.h>
+#endif
+
+namespace fastLEC
+{
+
+// ----------------------------------------------------------------------------
+// MPI environment
+// ----------------------------------------------------------------------------
+// the processes of the mpi_pSAT mode. MPI is initialized in main before the
+// miter is read: only rank 0 reads it, the other ranks wait for its XAG. a
+// build without MPI (USE_MPI_PSAT=OFF) runs a single rank.
+class MPIEnv
+{
+private:
+    bool initialized = false;
+    bool miter_sent = false; // whether rank 0 released the other ranks
+    int _rank = 0, _size = 1;
+
+    MPIEnv() = default;
+    MPIEnv(const MPIEnv &) = delete;
+    MPIEnv &operator=(const MPIEnv &) = delete;
+
+public:
+    static MPIEnv &get();
+
+    // return false if this build has no MPI
+    bool init(int *argc, char ***argv);
+    // rank 0 releases the ranks still waiting for a miter
+    void finalize();
+
+    int rank() const { return _rank; }
+    int size() const { return _size; }
+
+    // the XAG of rank 0, sent once in a compact binary form: every rank
+    // derives the same CNF, so the cubes are exchanged as CNF literals. a
+    // nullptr on rank 0 releases the other ranks, which get nullptr.
+    std::shared_ptr<fastLEC::XAG>
+    broadcast_xag(std::shared_ptr<fastLEC::XAG> xag);
+};
+
+// ----------------------------------------------------------------------------
+// Distributed PartitionSAT
+// ----------------------------------------------------------------------------
+// every rank runs a PartitionSAT with its local threads: rank 0 on the whole
+// miter, the other ranks on the tasks they steal. an idle rank asks a random
+// rank for a waiting task, the victim splits a running task if its pool is
+// drained. the result of a stolen task goes back to the victim, where it is
+// propagated as a local one. a SAT result stops all the ranks at once.
+class DistributedSAT
+{
+private:
+    std::shared_ptr<fastLEC::XAG> xag;
+    unsigned n_threads;
+    int rank, size;
+
+    // the local part of the space, solved in the solving thread
+    std::unique_ptr<PartitionSAT> ps;
+    std::thread solving;
+    std::atomic<bool> ps_done;
+    ret_vals ps_ret;
+    unsigned gen; // the generation of ps, the task ids are per generation
+
+    // where the stolen task of ps comes from
+    int victim, victim_gen, victim_task;
+    bool cancelled; // the victim does not need the result anymore
+
+    // the tasks of ps solved by other ranks: task id -> thief rank
+    std::unordered_map<int, int> exported;
+
+    bool stealing = false;   // a steal request is pending
+    double next_steal = 0.0; // after a failed request
+    bool stopping = false;
+    ret_vals final_ret = ret_vals::ret_UNK;
+
+    unsigned n_stolen = 0, n_exported = 0, n_steal_fails = 0;
+
+    void start(const std::vector<int> &cube);
+    void finish();
+    void stop_all(ret_vals ret);
+    void cancel_exported(bool only_solved);
+    bool handle_message();
+    void shutdown();
+
+#ifdef FASTLEC_MPI
+    // the sends are synchronous, so that no message is in flight when the
+    // ranks leave: see shutdown()
+    struct Outgoing
+    {
+        std::vector<int> buf;
+        MPI_Request req;
+    };
+    std::list<Outgoing> outbox;
+    void send(int dest, int tag, std::vector<int> msg);
+    void flush_outbox();
+#endif
+
+public:
+    DistributedSAT(std::shared_ptr<fastLEC::XAG> xag, unsigned n_threads);
+    ~DistributedSAT();
+
+    // the result of the miter, the same on every rank
+    ret_vals check();
+};
+
+} // namespace fastLEC
@@ -11,10 +11,28 @@ std::shared_mutex _prt_mtx;
 
 #define PRT_SOLVING_INFO
 
+// the kissat presets of the workers: a configuration, then options
+struct SolverPreset
+{
+    const char *name;
+    const char *configuration;
+    std::vector<std::pair<const char *, int>> options;
+};
+static const std::vector<SolverPreset> solver_presets = {
+    {"default", nullptr, {}},
+    {"unsat", "unsat", {}},
+    {"unsat-neg", "unsat", {{"phase", 0}}},
+    {"focused", nullptr, {{"stable", 0}}},
+    {"stable", nullptr, {{"stable", 2}, {"tier1", 3}, {"tier2", 8}}},
+    {"target", "unsat", {{"target", 2}, {"restartint", 10}}},
+    {"sat", "sat", {}},
+    {"tiers", nullptr, {{"tier1", 1}, {"tier2", 4}, {"chrono", 0}}},
+};
+
 void fastLEC::PartitionSAT::show_unsolved_tasks()
 {
     std::stringstream ss;
-    for (auto &task : all_tasks)
+    for (Task *task : all_tasks)
     {
         if (!task->is_solved())
         {
@@ -40,7 +58,7 @@ void fastLEC::PartitionSAT::show_detailed_tasks()
     ss << "c [All Task] ++++++++++++++++++++++";
     ss << std::left << std::setw(6) << std::right << this->all_tasks.size();
     ss << " tasks ++++++++++++++++++++++++++++++" << std::endl;
-    for (auto &task : all_tasks)
+    for (Task *task : all_tasks)
     {
         ss << "c [A] " << std::setw(6) << task->father;
         ss << " <f-";
@@ -121,7 +139,8 @@ std::ostream &fastLEC::operator<<(std::ostream &os, const PartitionSAT &ps)
 }
 
 fastLEC::PartitionSAT::PartitionSAT(std::shared_ptr<fastLEC::XAG> xag,
-                                    unsigned n_threads)
+                                    unsigned n_threads,
+                                    const std::vector<int> &root_cube)
     : xag(xag), n_threads(n_threads), stop(false),
       timeout_thread_running(false), states_updated(true),
       all_task_terminated(false)
@@ -129,18 +148,57 @@ fastLEC::PartitionSAT::PartitionSAT(std::shared_ptr<fastLEC::XAG> xag,
     root_cnf = xag->construct_cnf_from_this_xag();
     root_cnf->build_watches();
 
+    shared_clauses.max_size =
+        std::max(0, Param::get().custom_params.gt_share_size);
+    n_imported.store(0);
+
+    n_preempted.store(0);
+    if (Param::get().custom_params.gt_priority)
+        q_wait_ids.set_priority(
+            [this](int id)
+            {
+                return task_priority(id);
+            });
+
     all_task_terminated.store(false);
 
     solvers.resize(n_threads, nullptr);
 
     running_cpu_cnt.store(0);
 
-    std::shared_ptr<Task> root_task = std::make_shared<Task>();
-    root_task->id = ID_ROOT;
-    root_task->father = ID_NONE;
-    root_task->level = 0;
-    root_task->new_cube_lit_cnt = 0;
-    submit_task(root_task);
+    config_stats.resize(solver_presets.size());
+
+    submit_task(
+        [&](Task &root_task)
+        {
+            root_task.father = ID_NONE;
+            root_task.level = 0;
+            root_task.cube = root_cube;
+            root_task.new_cube_lit_cnt = 0;
+        });
+    std::vector<int> root_vars;
+    for (int l : root_cube)
+        root_vars.push_back(abs(l));
+    cube_keys.insert(cube_key(root_vars));
+
+    unsigned n_racers = std::min<unsigned>(
+        std::max(0, Param::get().custom_params.gt_portfolio), n_threads);
+    racing.store(n_racers > 1);
+    race_deadline = fastLEC::ResMgr::get().get_runtime() +
+        Param::get().custom_params.gt_portfolio_time;
+    for (unsigned i = 1; i < n_racers; i++)
+    {
+        // not a son: the root stays splittable after the race
+        racer_ids.push_back(submit_task(
+            [&](Task &racer)
+            {
+                racer.father = ID_ROOT;
+                racer.level = 1;
+                racer.racer = true;
+                racer.cube = root_cube;
+                racer.new_cube_lit_cnt = 0;
+            }));
+    }
 
     cpu_task_ids.resize(n_threads, ID_NONE);
 
@@ -162,6 +220,7 @@ fastLEC::PartitionSAT::~PartitionSAT()
 
     // stop timeout monitor thread
     timeout_thread_running.store(false);
+    notify_event();
     if (timeout_thread.joinable())
     {
         timeout_thread.join();
@@ -181,7 +240,7 @@ fastLEC::ret_vals fastLEC::PartitionSAT::prop_task_status()
     int tid;
     while (q_prop_ids.try_pop(tid))
     {
-        std::shared_ptr<Task> t = get_task_by_id(tid);
+        Task *t = get_task_by_id(tid);
         if (t->is_sat())
         {
 #ifdef PRT_SOLVING_INFO
@@ -192,6 +251,9 @@ fastLEC::ret_vals fastLEC::PartitionSAT::prop_task_status()
                 std::cout << std::flush;
             }
 #endif
+            // a model under a cube is a model of the root
+            if (!t->is_root())
+                all_tasks[ID_ROOT]->set_state(SATISFIABLE);
             terminate_all_tasks();
             return ret_vals::ret_SAT;
         }
@@ -211,12 +273,18 @@ fastLEC::ret_vals fastLEC::PartitionSAT::prop_task_status()
                 return ret_vals::ret_UNS;
             }
 
+            share_refuted_cube(t);
             std::vector<int> propagated;
 
             // propagate father;
             if (t->father != ID_NONE && !all_tasks[t->father]->is_solved())
             {
-                for (auto brothers : all_tasks[t->father]->sons)
+                // a racer has the cube of its father
+                std::vector<std::vector<int>> groups =
+                    all_tasks[t->father]->sons;
+                if (t->racer)
+                    groups.push_back({t->id});
+                for (auto brothers : groups)
                 {
                     bool all_brothers_unsat = true;
                     for (auto &bro : brothers)
@@ -233,6 +301,7 @@ fastLEC::ret_vals fastLEC::PartitionSAT::prop_task_status()
                         all_tasks[t->father]->set_state(
                             task_states::UNSATISFIABLE);
                         terminate_task_by_id(t->father);
+                        share_refuted_cube(all_tasks[t->father]);
                     }
                 }
             }
@@ -274,81 +343,180 @@ fastLEC::ret_vals fastLEC::PartitionSAT::prop_task_status()
     return ret_vals::ret_UNK;
 }
 
+void fastLEC::PartitionSAT::share_refuted_cube(const Task *task)
+{
+    std::vector<int> clause;
+    for (int l : task->cube)
+        clause.push_back(-l);
+    shared_clauses.export_clause(std::move(clause));
+}
+
 void fastLEC::PartitionSAT::worker_func(int cpu_id)
 {
-    int free_cnt = 0;
+    // the idle wait is also a poll for a task to split, 1 ms at least so
+    // that a zero delay does not spin
+    auto split_delay = std::chrono::duration<double>(
+        std::max(Param::get().custom_params.gt_split_delay, 1e-3));
     while (!stop.load())
     {
         int id = ID_NONE;
 
         if (!q_wait_ids.try_pop(id))
         {
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
-            free_cnt++;
-            if (free_cnt > 100)
+            // the pool is drained, split a running task right away
+            int r = ret_cannot_split;
+            if (split_mutex.try_lock())
             {
-                free_cnt = 0;
+                Task *task = pick_split_task();
 
-                if (split_mutex.try_lock())
+                if (task)
                 {
-                    std::shared_ptr<Task> task = pick_split_task();
-
                     if (Param::get().custom_params.vis)
                     {
                         Visualizer vis(this->xag);
                         vis.visualize(task->cube);
                     }
 
-                    if (task)
-                    {
-                        int r = split_task_and_submit(task);
+                    r = split_task_and_submit(task);
 
-                        if (r == ret_father_solved)
-                            terminate_task_by_id(task->id);
-                    }
-                    split_mutex.unlock();
+                    if (r == ret_father_solved)
+                        terminate_task_by_id(task->id);
                 }
+                split_mutex.unlock();
+            }
+
+            // otherwise wait for an event, or for a task to become old
+            // enough to be split
+            if (r != ret_success_split)
+            {
+                std::unique_lock<std::mutex> lock(event_mtx);
+                event_cv.wait_for(lock,
+                                  split_delay,
+                                  [this]()
+                                  {
+                                      return stop.load() ||
+                                          !q_wait_ids.empty();
+                                  });
             }
             continue;
         }
 
-        std::shared_ptr<Task> task = get_task_by_id(id);
+        Task *task = get_task_by_id(id);
+        // the task may be solved by a propagation, or exported to another
+        // process, while it waits in the pool
+        task_states waiting = WAITING;
+        if (!task->state.compare_exchange_strong(waiting, ADDING))
+            continue;
+        if (task->racer && !racing.load())
+        {
+            // the race ended before this racer started
+            task->set_state(UNKNOWN);
+            continue;
+        }
 
         task->cpu = cpu_id;
         task->start_time = fastLEC::ResMgr::get().get_runtime();
 
         {
+            // the terminations read the solver under the cpu lock
             std::lock_guard<std::mutex> lock(*mutexes[cpu_id]);
             cpu_task_ids[cpu_id] = task->id;
+            assert(solvers[cpu_id] == nullptr);
+            solvers[cpu_id] =
+                std::shared_ptr<kissat>(kissat_init(), kissat_release);
         }
 
-        task->set_state(ADDING);
-
         int result = 0;
 
-        assert(solvers[cpu_id] == nullptr);
-        solvers[cpu_id] =
-            std::shared_ptr<kissat>(kissat_init(), kissat_release);
+        task->config = configure_solver(solvers[cpu_id].get(), cpu_id);
+        if (task->racer && Param::get().custom_params.gt_conflicts > 0)
+            kissat_set_conflict_limit(solvers[cpu_id].get(),
+                                      Param::get().custom_params.gt_conflicts);
+
+        auto add_clauses =
+            [&](const std::vector<int> &lits, const std::vector<int> &ends)
+        {
+            int start_pos = 0, end_pos = 0;
+            for (unsigned i = 0; i < ends.size(); i++)
+            {
+                end_pos = ends[i];
+                for (int j = start_pos; j < end_pos; j++)
+                {
+                    kissat_add(solvers[cpu_id].get(), lits[j]);
+                }
+                kissat_add(solvers[cpu_id].get(), 0);
+                start_pos = end_pos;
+            }
+        };
 
-        int start_pos = 0, end_pos = 0;
-        for (int i = 0; i < root_cnf->num_clauses(); i++)
+        bool conflict = false;
+        bool reduce = Param::get().custom_params.gt_reduce_cnf;
+        std::vector<bool> assigned, value;
+        if (reduce)
+        {
+            // only the residual formula under the cube is loaded
+            BCPEngine bcp(*root_cnf);
+            std::vector<int> res_lits, res_end_pos;
+            conflict = !bcp.assume(task->cube);
+            bcp.get_assignment(assigned, value);
+            conflict = conflict ||
+                !root_cnf->residual_circuit(
+                    assigned, value, res_lits, res_end_pos);
+            if (!conflict)
+                add_clauses(res_lits, res_end_pos);
+        }
+        else
         {
-            end_pos = root_cnf->cls_end_pos[i];
-            for (int j = start_pos; j < end_pos; j++)
+            add_clauses(root_cnf->lits, root_cnf->cls_end_pos);
+            for (int l : task->cube)
             {
-                kissat_add(solvers[cpu_id].get(), root_cnf->lits[j]);
+                kissat_add(solvers[cpu_id].get(), l);
+                kissat_add(solvers[cpu_id].get(), 0);
             }
-            kissat_add(solvers[cpu_id].get(), 0);
-            start_pos = end_pos;
         }
 
-        for (int l : task->cube)
+        if (!conflict && shared_clauses.size() > 0)
         {
-            kissat_add(solvers[cpu_id].get(), l);
-            kissat_add(solvers[cpu_id].get(), 0);
+            // the clauses shared by the other tasks, reduced under the cube
+            std::vector<int> sh_lits, sh_ends, red_lits, red_ends;
+            shared_clauses.snapshot(sh_lits, sh_ends);
+            int begin = 0;
+            for (unsigned i = 0; i < sh_ends.size() && !conflict; i++)
+            {
+                bool sat = false;
+                unsigned pos = red_lits.size();
+                for (int j = begin; j < sh_ends[i] && !sat; j++)
+                {
+                    int lit = sh_lits[j], v = abs(lit);
+                    if (!reduce || !assigned[v])
+                        red_lits.push_back(lit);
+                    else if (value[v] == (lit > 0))
+                        sat = true;
+                }
+                begin = sh_ends[i];
+
+                if (sat)
+                    red_lits.resize(pos);
+                else if (red_lits.size() == pos)
+                    conflict = true;
+                else
+                    red_ends.push_back(red_lits.size());
+            }
+            if (!conflict)
+            {
+                add_clauses(red_lits, red_ends);
+                n_imported += red_ends.size();
+            }
         }
 
-        if (!stop.load())
+        if (conflict)
+        {
+            // refuted by the propagation of the cube. the state is set
+            // before the id is queued, prop_task_status() reads it.
+            task->set_state(UNSATISFIABLE);
+            q_prop_ids.emplace(std::move(id));
+        }
+        else if (!stop.load())
         {
             task->set_state(RUNNING);
             running_cpu_cnt++;
@@ -371,14 +539,42 @@ void fastLEC::PartitionSAT::worker_func(int cpu_id)
             }
             else
             {
-                q_prop_ids.emplace(std::move(id));
-
                 if (result == 10)
                     task->set_state(SATISFIABLE);
                 else if (result == 20)
                     task->set_state(UNSATISFIABLE);
                 else if (!task->is_solved())
                     task->set_state(UNKNOWN);
+
+                q_prop_ids.emplace(std::move(id));
+            }
+
+            {
+                double t = fastLEC::ResMgr::get().get_runtime() -
+                    task->start_time;
+                std::lock_guard<std::mutex> lock(config_mtx);
+                ConfigStats &st = config_stats[task->config];
+                if (result == 10)
+                    st.n_sat++;
+                else if (result == 20)
+                    st.n_unsat++;
+                else
+                    st.n_unknown++;
+                st.time += t;
+
+                // the configuration deciding the whole miter
+                bool decisive = result == 10 ||
+                    (result == 20 && (task->is_root() || task->racer));
+                if (decisive && Param::get().verbose > 0)
+                {
+                    printf("c [pSAT] T%d decides the miter with config %s on "
+                           "cpu%d in %.2fs\n",
+                           task->id,
+                           solver_presets[task->config].name,
+                           cpu_id,
+                           t);
+                    fflush(stdout);
+                }
             }
 
             if (task->id == ID_ROOT && task->is_solved())
@@ -406,18 +602,66 @@ void fastLEC::PartitionSAT::worker_func(int cpu_id)
 #endif
         }
         task->terminate_info_upd();
+        // the sons already hold the split scores
+        std::atomic_store(&task->split_scores,
+                          std::shared_ptr<const SplitScores>());
+        std::shared_ptr<kissat> done; // released out of the lock
         {
             std::lock_guard<std::mutex> lock(*mutexes[cpu_id]);
             cpu_task_ids[cpu_id] = ID_NONE;
+            done.swap(solvers[cpu_id]);
         }
+        done.reset();
 
         fastLEC::ret_vals ret = ret_vals::ret_UNK;
         ret = prop_task_status();
+        notify_event();
         if (ret == ret_vals::ret_SAT || ret == ret_vals::ret_UNS)
             break;
     }
 }
 
+int fastLEC::PartitionSAT::configure_solver(kissat *solver, int cpu_id) const
+{
+    if (!Param::get().custom_params.gt_diversify)
+        return 0;
+
+    // the first worker gets the UNSAT tuned preset, miters are mostly UNSAT
+    int preset = (cpu_id + 1) % solver_presets.size();
+    const SolverPreset &p = solver_presets[preset];
+    if (p.configuration != nullptr)
+        kissat_set_configuration(solver, p.configuration);
+    for (auto &opt : p.options)
+        kissat_set_option(solver, opt.first, opt.second);
+    kissat_set_option(
+        solver, "seed", Param::get().custom_params.seed + cpu_id);
+    return preset;
+}
+
+void fastLEC::PartitionSAT::end_race()
+{
+    racing.store(false);
+    for (int id : racer_ids)
+        if (!all_tasks[id]->is_solved())
+            terminate_task_by_id(id);
+
+    if (Param::get().verbose > 1)
+    {
+        printf("c [pSAT] portfolio race ended, the root can be split\n");
+        fflush(stdout);
+    }
+    notify_event();
+}
+
+void fastLEC::PartitionSAT::notify_event()
+{
+    // taking the lock orders the notification after the checks of a waiter
+    {
+        std::lock_guard<std::mutex> lock(event_mtx);
+    }
+    event_cv.notify_all();
+}
+
 void fastLEC::PartitionSAT::timeout_monitor_func()
 {
 
@@ -429,7 +673,22 @@ void fastLEC::PartitionSAT::timeout_monitor_func()
     int last_task_num = -prt_alltask_interval - 1;
     while (timeout_thread_running.load())
     {
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        {
+            // the stop wakes the monitor up, the time limit and the PPE
+            // flag are still checked every 100 ms
+            double left = fastLEC::Param::get().time_limit() -
+                fastLEC::ResMgr::get().get_runtime();
+            auto wait = std::chrono::duration<double>(
+                std::max(0.0, std::min(left, 0.1)));
+            std::unique_lock<std::mutex> lock(event_mtx);
+            event_cv.wait_for(lock,
+                              wait,
+                              [this]()
+                              {
+                                  return stop.load() ||
+                                      !timeout_thread_running.load();
+                              });
+        }
 
 #ifdef PRT_SOLVING_INFO
         if (fastLEC::ResMgr::get().get_runtime() - last_prt_time >
@@ -456,6 +715,10 @@ void fastLEC::PartitionSAT::timeout_monitor_func()
         if (stop.load())
             break;
 
+        if (racing.load() &&
+            fastLEC::ResMgr::get().get_runtime() >= race_deadline)
+            end_race();
+
         if (global_solved_for_PPE.load())
         {
             if (fastLEC::Param::get().verbose > 1)
@@ -468,13 +731,13 @@ void fastLEC::PartitionSAT::timeout_monitor_func()
             break;
         }
         if (fastLEC::ResMgr::get().get_runtime() >
-            fastLEC::Param::get().timeout)
+            fastLEC::Param::get().time_limit())
         {
             if (fastLEC::Param::get().verbose > 1)
             {
                 printf(
                     "c [pSAT] Timeout reached (%.2fs), terminating all tasks\n",
-                    fastLEC::Param::get().timeout);
+                    fastLEC::Param::get().time_limit());
                 fflush(stdout);
             }
             terminate_all_tasks();
@@ -483,8 +746,7 @@ void fastLEC::PartitionSAT::timeout_monitor_func()
     }
 }
 
-std::shared_ptr<fastLEC::Task>
-fastLEC::PartitionSAT::get_task_by_cpu(int cpu_id)
+fastLEC::Task *fastLEC::PartitionSAT::get_task_by_cpu(int cpu_id)
 {
     if (cpu_id < 0 || cpu_id >= static_cast<int>(n_threads))
         return nullptr;
@@ -493,16 +755,15 @@ fastLEC::PartitionSAT::get_task_by_cpu(int cpu_id)
     return get_task_by_id(cpu_task_ids[cpu_id]);
 }
 
-std::shared_ptr<fastLEC::Task>
-fastLEC::PartitionSAT::get_task_by_id(int task_id)
+fastLEC::Task *fastLEC::PartitionSAT::get_task_by_id(int task_id)
 {
-    if (task_id < 0 || task_id > (int)all_tasks.size())
+    if (task_id < 0 || task_id >= (int)all_tasks.size())
         return nullptr;
     return all_tasks[task_id];
 }
 
 bool fastLEC::PartitionSAT::propagate_task(
-    std::shared_ptr<Task> task,
+    Task *task,
     std::vector<bool> &forbidden_vars,
     std::vector<int> &new_decision_lits,
     std::vector<int> &new_propagated_lits)
@@ -535,17 +796,112 @@ bool fastLEC::PartitionSAT::propagate_task(
     return true;
 }
 
-int fastLEC::PartitionSAT::submit_task(std::shared_ptr<Task> task)
+int fastLEC::PartitionSAT::submit_task(
+    const std::function<void(Task &)> &init)
+{
+    int task_id = all_tasks.emplace_back(
+        [&](Task &task)
+        {
+            init(task);
+            task.create_time = fastLEC::ResMgr::get().get_runtime();
+        });
+    q_wait_ids.emplace(task_id);
+    notify_event();
+    return task_id;
+}
+
+int fastLEC::PartitionSAT::submit_group(
+    unsigned n_tasks, const std::function<void(Task &, unsigned)> &init)
 {
-    if (task)
+    int first = all_tasks.emplace_group(
+        n_tasks,
+        [&](Task &task, unsigned i)
+        {
+            init(task, i);
+            task.bro_first = task.id - i;
+            task.bro_cnt = n_tasks;
+            task.create_time = fastLEC::ResMgr::get().get_runtime();
+        });
+    for (unsigned i = 0; i < n_tasks; i++)
+        q_wait_ids.emplace(first + i);
+    notify_event();
+    return first;
+}
+
+int fastLEC::PartitionSAT::export_task(std::vector<int> &cube)
+{
+    auto claim = [this]() -> Task *
     {
-        task->create_time = fastLEC::ResMgr::get().get_runtime();
-        int task_id = task->id = (int)all_tasks.size();
-        all_tasks.push_back(std::move(task));
-        q_wait_ids.emplace(std::move(task_id));
-        return task_id;
+        // popped as by a worker, so that the pool holds no exported task
+        int id;
+        while (q_wait_ids.try_pop(id))
+        {
+            Task *task = get_task_by_id(id);
+            if (task->is_root() || task->racer)
+            {
+                // kept for the local workers
+                q_wait_ids.emplace(id);
+                return nullptr;
+            }
+            task_states waiting = WAITING;
+            if (task->state.compare_exchange_strong(waiting, RUNNING))
+                return task;
+        }
+        return nullptr;
+    };
+
+    if (stop.load())
+        return ID_NONE;
+
+    Task *task = claim();
+    if (task == nullptr && split_mutex.try_lock())
+    {
+        // the other process is an idle worker of this pool
+        int r = ret_cannot_split;
+        Task *father = pick_split_task();
+        if (father)
+        {
+            r = split_task_and_submit(father);
+            if (r == ret_father_solved)
+                terminate_task_by_id(father->id);
+        }
+        split_mutex.unlock();
+        if (r == ret_success_split)
+            task = claim();
     }
-    return ID_NONE;
+    if (task == nullptr)
+        return ID_NONE;
+
+    task->remote = true;
+    task->start_time = fastLEC::ResMgr::get().get_runtime();
+    cube = task->cube;
+    return task->id;
+}
+
+void fastLEC::PartitionSAT::import_result(int task_id, ret_vals ret)
+{
+    Task *task = get_task_by_id(task_id);
+    if (task == nullptr || !task->remote)
+        return;
+    task->remote = false;
+
+    // a task solved in the meantime (by a propagation) or stopped is kept
+    task_states running = RUNNING;
+    if (ret == ret_vals::ret_SAT || ret == ret_vals::ret_UNS)
+    {
+        task_states s = ret == ret_vals::ret_SAT ? SATISFIABLE : UNSATISFIABLE;
+        if (task->state.compare_exchange_strong(running, s))
+        {
+            task->stop_time = fastLEC::ResMgr::get().get_runtime();
+            q_prop_ids.emplace(task_id);
+            states_updated.store(true);
+        }
+        prop_task_status();
+    }
+    else if (!stop.load() &&
+             task->state.compare_exchange_strong(running, WAITING))
+        q_wait_ids.emplace(task_id);
+    notify_event();
 }
 
 std::shared_ptr<kissat> fastLEC::PartitionSAT::get_solver_by_cpu(int cpu_id)
@@ -560,7 +916,7 @@ std::shared_ptr<kissat> fastLEC::PartitionSAT::get_solver_by_cpu(int cpu_id)
 void fastLEC::PartitionSAT::terminate_task_by_id(int task_id)
 {
 
-    std::shared_ptr<Task> task = get_task_by_id(task_id);
+    Task *task = get_task_by_id(task_id);
     if (task == nullptr || task->cpu == CPU_NONE)
         return;
 
@@ -598,46 +954,47 @@ void fastLEC::PartitionSAT::terminate_all_tasks()
     for (unsigned i = 0; i < n_threads; i++)
         terminate_task_by_cpu(i);
 
-    for (auto &t : all_tasks)
+    for (Task *t : all_tasks)
         t->terminate_info_upd();
+
+    notify_event();
 }
 
-bool fastLEC::PartitionSAT::check_repeat(std::vector<int> &cube_var) const
+uint64_t fastLEC::PartitionSAT::cube_key(const std::vector<int> &vars)
 {
-    int cnt = 1;
-    std::vector<int> mark(root_cnf->num_vars + 1, 0);
-    for (auto &task : all_tasks)
-    {
-        // check cube_var in task->cube
-        if (cube_var.size() > task->cube.size())
-            continue;
-
-        for (int l : task->cube)
-            mark[abs(l)] = cnt;
-
-        bool is_subset = true;
-        for (int v : cube_var)
-        {
-            if (mark[v] != cnt)
-            {
-                is_subset = false;
-                break;
-            }
-        }
-        if (is_subset)
-            return true;
-        cnt++;
-    }
+    std::vector<int> sorted = vars;
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    // order independent: the xor of the hashed variables
+    uint64_t key = mix64(sorted.size());
+    for (int v : sorted)
+        key ^= mix64((uint64_t)v * 0x9e3779b97f4a7c15ull);
+    return key;
+}
 
-    return false;
+bool fastLEC::PartitionSAT::check_repeat(
+    const std::vector<int> &cube_vars) const
+{
+    return cube_keys.count(cube_key(cube_vars)) > 0;
 }
 
-int fastLEC::PartitionSAT::split_task_and_submit(
-    std::shared_ptr<fastLEC::Task> father)
+int fastLEC::PartitionSAT::split_task_and_submit(fastLEC::Task *father)
 {
-    std::vector<int> split_vars = pick_split_vars(father);
+    std::vector<int> units;
+    std::vector<double> hardness;
+    std::vector<int> split_vars = pick_split_vars(father, units, hardness);
     if (split_vars.size() == 1 && split_vars[0] == 0) // UNSAT: {0}
+    {
+        // the cube is refuted by the propagation
+        if (!father->is_solved())
+        {
+            int id = father->id;
+            father->set_state(UNSATISFIABLE);
+            q_prop_ids.emplace(std::move(id));
+        }
         return ret_father_solved;
+    }
 
     if (father->is_solved())
         return ret_father_solved;
@@ -659,29 +1016,20 @@ int fastLEC::PartitionSAT::split_task_and_submit(
     if (is_repeat)
         return ret_repeat_task;
 
-    std::vector<std::shared_ptr<fastLEC::Task>> sons;
+    std::vector<std::vector<int>> son_cubes;
     std::vector<int> sons_ids;
     for (unsigned cnt = 0; cnt < (1ul << split_vars.size()); cnt++)
     {
-        std::shared_ptr<fastLEC::Task> new_task =
-            std::make_shared<fastLEC::Task>();
-
-        new_task->father = father->id;
-        new_task->level = father->level + 1;
-        new_task->cube = father->cube;
+        std::vector<int> cube = father->cube;
+        cube.insert(cube.end(), units.begin(), units.end());
         for (unsigned i = 0; i < split_vars.size(); i++)
         {
             if (cnt & (1 << i))
-                new_task->cube.push_back(split_vars[i]);
+                cube.push_back(split_vars[i]);
             else
-                new_task->cube.push_back(-split_vars[i]);
+                cube.push_back(-split_vars[i]);
         }
-        new_task->new_cube_lit_cnt = split_vars.size();
-
-        sons.push_back(new_task);
-        // Note: new_task->id will be set in submit_task, so we can't
-        // use it here sons_ids will be populated after submit_task
-        // calls
+        son_cubes.push_back(std::move(cube));
 
         if (father->is_solved())
             break;
@@ -692,15 +1040,29 @@ int fastLEC::PartitionSAT::split_task_and_submit(
 
     if (!father->is_solved())
     {
-        // Submit all tasks and collect their IDs
-        for (unsigned i = 0; i < sons.size(); i++)
-        {
-            int task_id = submit_task(std::move(sons[i]));
-            // The task ID is set in submit_task, so we need to get it
-            // from the last added task
-            sons_ids.push_back(task_id);
-        }
+        std::shared_ptr<const SplitScores> scores =
+            std::atomic_load(&father->split_scores);
+        int first_id = submit_group(
+            son_cubes.size(),
+            [&](Task &new_task, unsigned i)
+            {
+                new_task.father = father->id;
+                new_task.level = father->level + 1;
+                new_task.cube = std::move(son_cubes[i]);
+                new_task.new_cube_lit_cnt = split_vars.size();
+                new_task.split_scores = scores;
+                if (i < hardness.size())
+                    new_task.hardness = hardness[i];
+            });
+        for (unsigned i = 0; i < son_cubes.size(); i++)
+            sons_ids.push_back(first_id + i);
         father->sons.push_back(sons_ids);
+
+        cube_keys.insert(cube_key(split_vars_tmp));
+        std::vector<int> son_vars = split_vars_tmp;
+        for (int l : units)
+            son_vars.push_back(abs(l));
+        cube_keys.insert(cube_key(son_vars));
 #ifdef PRT_SOLVING_INFO
         std::stringstream ss;
         ss << "c    [;] T" << father->id << " -s> ";
@@ -728,8 +1090,7 @@ int fastLEC::PartitionSAT::split_task_and_submit(
         return ret_father_solved;
 }
 
-bool fastLEC::PartitionSAT::compute_mask(std::shared_ptr<Task> task,
-                                         std::vector<bool> &mask)
+bool fastLEC::PartitionSAT::compute_mask(Task *task, std::vector<bool> &mask)
 {
 
     mask.resize(root_cnf->num_vars + 1, false);
@@ -740,19 +1101,26 @@ bool fastLEC::PartitionSAT::compute_mask(std::shared_ptr<Task> task,
 }
 
 std::vector<int>
-fastLEC::PartitionSAT::pick_split_vars(std::shared_ptr<fastLEC::Task> father)
+fastLEC::PartitionSAT::pick_split_vars(fastLEC::Task *father,
+                                       std::vector<int> &units,
+                                       std::vector<double> &hardness)
 {
-    std::vector<int> propagated_lits = father->cube;
-
-    std::vector<bool> mask(root_cnf->num_vars + 1, false);
-
-    bool res = compute_mask(father, mask);
-
-    if (!res)
+    // the propagation of the cube, the lookahead probes extend its trail
+    BCPEngine bcp(*root_cnf);
+    if (!bcp.assume(father->cube))
         return std::vector<int>({0});
 
-    std::vector<double> scores;
-    compute_scores(mask, scores);
+    std::vector<bool> mask, val;
+    bcp.get_assignment(mask, val);
+
+    // the scores of the father (or of its last split) are updated under the
+    // newly assigned variables
+    std::shared_ptr<const SplitScores> prev =
+        std::atomic_load(&father->split_scores);
+    std::shared_ptr<const SplitScores> cur =
+        prev ? update_split_scores(prev, mask) : full_split_scores(mask);
+    std::atomic_store(&father->split_scores, cur);
+    const std::vector<double> &scores = cur->scores;
 
     std::vector<int> candidates_vars;
 
@@ -780,6 +1148,9 @@ fastLEC::PartitionSAT::pick_split_vars(std::shared_ptr<fastLEC::Task> father)
         std::swap(candidates_vars[pos], candidates_vars[pos + 1]);
     }
 
+    if (!lookahead(father, bcp, candidates_vars, units))
+        return std::vector<int>({0});
+
     unsigned pick_var_num = this->decide_split_var_num();
 
     std::vector<int> pick_vars;
@@ -791,9 +1162,11 @@ fastLEC::PartitionSAT::pick_split_vars(std::shared_ptr<fastLEC::Task> father)
         pick_vars.push_back(pick_aig_v);
     }
 
-    if (pick_vars.size() == 0)
-        return std::vector<int>({0});
+    // the sons are scheduled by the propagation of their cubes
+    if (!pick_vars.empty() && Param::get().custom_params.gt_priority)
+        estimate_hardness(bcp, pick_vars, hardness);
 
+    // {0} stands for a refuted cube only, no candidate is no split
     return pick_vars;
 }
 
@@ -832,6 +1205,29 @@ fastLEC::ret_vals fastLEC::PartitionSAT::check()
                this->root_cnf->num_clauses(),
                this->root_cnf->num_lits(),
                fastLEC::ResMgr::get().get_runtime() - start_time);
+        if (shared_clauses.size() > 0)
+            printf("c [pSAT] shared clauses = %u, imported = %u\n",
+                   shared_clauses.size(),
+                   n_imported.load());
+        for (unsigned i = 0; i < config_stats.size(); i++)
+        {
+            const ConfigStats &st = config_stats[i];
+            if (st.n_sat + st.n_unsat + st.n_unknown == 0)
+                continue;
+            printf("c [pSAT] config %-9s sat = %u, unsat = %u, unknown = %u, "
+                   "time = %.2f\n",
+                   solver_presets[i].name,
+                   st.n_sat,
+                   st.n_unsat,
+                   st.n_unknown,
+                   st.time);
+        }
+        if (n_preempted.load() > 0)
+            printf("c [pSAT] preempted tasks = %u\n", n_preempted.load());
+        if (n_full_scores + n_upd_scores > 0)
+            printf("c [pSAT] split scores: full = %u, incremental = %u\n",
+                   n_full_scores,
+                   n_upd_scores);
         fflush(stdout);
     }
 
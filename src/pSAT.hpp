@@ -2,11 +2,13 @@
 
 #include <queue>
 #include <vector>
+#include <unordered_set>
 #include <mutex>
 #include <thread>
 #include <memory>
 #include <atomic>
 #include <shared_mutex>
+#include <condition_variable>
 
 #include "XAG.hpp"
 #include "CNF.hpp"
@@ -45,9 +47,19 @@ private:
     std::vector<std::unique_ptr<std::mutex>> mutexes;
     std::vector<std::shared_ptr<kissat>> solvers;
 
-    SQueue<int> q_wait_ids;                       // waiting to be added tasks
-    SQueue<int> q_prop_ids;                       // newly solved tasks
-    std::vector<std::shared_ptr<Task>> all_tasks; // vector to save all tasks
+    TaskScheduler q_wait_ids; // waiting to be added tasks
+    IdQueue q_prop_ids;       // newly solved tasks
+    TaskArena all_tasks;      // all the tasks, by id
+    std::atomic<unsigned> n_preempted;
+
+    // the hashes of the variable sets of the cubes and of the splits, for
+    // the repeat checks (under split_mutex)
+    std::unordered_set<uint64_t> cube_keys;
+    static uint64_t cube_key(const std::vector<int> &vars);
+
+    ClauseChannel shared_clauses; // the refuted cubes and the failed literals
+    std::atomic<unsigned> n_imported;
+    void share_refuted_cube(const Task *task);
 
     std::atomic<bool> stop;
     std::atomic<int> running_cpu_cnt;
@@ -62,50 +74,122 @@ private:
 
     std::mutex split_mutex; // only one task can be split at a time
 
+    // the workers run diversified kissat presets (see pSAT.cpp), the
+    // outcomes are counted by preset to tune the defaults
+    struct ConfigStats
+    {
+        unsigned n_sat = 0, n_unsat = 0, n_unknown = 0;
+        double time = 0.0;
+    };
+    std::vector<ConfigStats> config_stats;
+    std::mutex config_mtx;
+    int configure_solver(kissat *solver, int cpu_id) const;
+
+    // the portfolio race: copies of the root run with the presets of their
+    // workers, the root is only split after the race
+    std::vector<int> racer_ids;
+    std::atomic<bool> racing;
+    double race_deadline = 0.0;
+    void end_race();
+
+    // the idle workers and the monitor wait for an event: a submitted task,
+    // a solved task or the stop
+    std::mutex event_mtx;
+    std::condition_variable event_cv;
+    void notify_event();
+
     void timeout_monitor_func();
 
 public:
-    PartitionSAT(std::shared_ptr<fastLEC::XAG> xag, unsigned n_threads);
+    // the root task gets root_cube: a part of the space handed over by
+    // another process (see mpi_pSAT.hpp), empty for the whole miter
+    PartitionSAT(std::shared_ptr<fastLEC::XAG> xag,
+                 unsigned n_threads,
+                 const std::vector<int> &root_cube = {});
     ~PartitionSAT();
 
-    std::shared_ptr<fastLEC::Task> get_task_by_cpu(int cpu_id);
-    std::shared_ptr<fastLEC::Task> get_task_by_id(int task_id);
+    fastLEC::Task *get_task_by_cpu(int cpu_id);
+    fastLEC::Task *get_task_by_id(int task_id);
     std::shared_ptr<kissat> get_solver_by_cpu(int cpu_id);
     unsigned num_tasks() const { return all_tasks.size(); }
 
     // ------------------------------------------------------------
     // mask is variables that should not be used.
-    bool compute_mask(std::shared_ptr<fastLEC::Task> task,
-                      std::vector<bool> &mask);
+    bool compute_mask(fastLEC::Task *task, std::vector<bool> &mask);
     void compute_scores(const std::vector<bool> &mask,
                         std::vector<double> &scores);
+    // the split scores from scratch, or updated from the ones of an earlier
+    // mask: only the region of the newly assigned variables is recomputed
+    std::shared_ptr<const SplitScores>
+    full_split_scores(const std::vector<bool> &mask);
+    std::shared_ptr<const SplitScores>
+    update_split_scores(const std::shared_ptr<const SplitScores> &prev,
+                        const std::vector<bool> &mask);
+    unsigned n_full_scores = 0, n_upd_scores = 0; // under split_mutex
     // ------------------------------------------------------------
     ret_vals prop_task_status();
 
-    bool propagate_task(std::shared_ptr<Task> task,
+    bool propagate_task(Task *task,
                         std::vector<bool> &forbidden_vars,
                         std::vector<int> &new_decision_lits,
                         std::vector<int> &new_propagated_lits);
-    int submit_task(std::shared_ptr<Task> task);
+    // the task is initialized by init before it is published
+    int submit_task(const std::function<void(Task &)> &init);
+    // the sons of a split, with consecutive ids. return the first id.
+    int submit_group(unsigned n_tasks,
+                     const std::function<void(Task &, unsigned)> &init);
+
+    // ------------------------------------------------------------
+    // the tasks solved by other processes: a waiting task is claimed from
+    // the pool, which is refilled by a split if it is drained. return the
+    // task id, ID_NONE if there is no task to give.
+    int export_task(std::vector<int> &cube);
+    // the result of an exported task is propagated as a local one, an
+    // unknown result puts the task back to the pool
+    void import_result(int task_id, ret_vals ret);
+    bool is_stopped() const { return stop.load(); }
+    // ------------------------------------------------------------
 
     void terminate_task_by_id(int task_id);
     void terminate_task_by_cpu(int cpu_id);
     void terminate_all_tasks();
 
     // heuristic 1
-    std::shared_ptr<fastLEC::Task> pick_split_task();
+    fastLEC::Task *pick_split_task();
 
     // heuristic 2
     int decide_split_var_num();
-    bool check_repeat(std::vector<int> &cube_vars) const;
+    bool check_repeat(const std::vector<int> &cube_vars) const;
+
+    // heuristic 3: both polarities of the first candidates are propagated
+    // on top of the cube in bcp, the candidates are re-ranked by the
+    // propagated literals and the failed literals give implied units.
+    // return false if the cube is refuted.
+    bool lookahead(fastLEC::Task *father,
+                   BCPEngine &bcp,
+                   std::vector<int> &candidates,
+                   std::vector<int> &units);
+
+    // heuristic 4: the waiting task to run first. a task of a nearly closed
+    // group of brothers, a deep one, an easy one (by the propagation of its
+    // cube) and an old one are preferred. return a negative priority if the
+    // task has left the pool, or is preempted since an ancestor is refuted.
+    double task_priority(int task_id);
+    // the hardness of the sons over split_vars, by the propagation of their
+    // cubes on top of the one of the father in bcp: indexed as the sons
+    void estimate_hardness(BCPEngine &bcp,
+                           const std::vector<int> &split_vars,
+                           std::vector<double> &hardness);
 #define ret_father_solved 0
 #define ret_success_split 1
 #define ret_cannot_split 2
 #define ret_repeat_task 3
 #define ret_max_split 4
 #define ret_pool_has_tasks 5
-    int split_task_and_submit(std::shared_ptr<fastLEC::Task> father);
-    std::vector<int> pick_split_vars(std::shared_ptr<fastLEC::Task> father);
+    int split_task_and_submit(fastLEC::Task *father);
+    std::vector<int> pick_split_vars(fastLEC::Task *father,
+                                     std::vector<int> &units,
+                                     std::vector<double> &hardness);
 
     void show_unsolved_tasks();
     void show_detailed_tasks();
@@ -2,6 +2,11 @@
 #include "XAG.hpp"
 #include "parser.hpp"
 
+#include <algorithm>
+#include <climits>
+#include <functional>
+#include <queue>
+
 int fastLEC::PartitionSAT::decide_split_var_num()
 {
     int ct = 1;
@@ -17,11 +22,12 @@ int fastLEC::PartitionSAT::decide_split_var_num()
     return ct;
 }
 
-std::shared_ptr<fastLEC::Task> fastLEC::PartitionSAT::pick_split_task()
+fastLEC::Task *fastLEC::PartitionSAT::pick_split_task()
 {
     unsigned max_split = fastLEC::Param::get().custom_params.gt_max_split;
+    double min_rt = fastLEC::Param::get().custom_params.gt_split_delay;
     double max_rt = -1;
-    std::shared_ptr<Task> target_task = nullptr;
+    Task *target_task = nullptr;
 
     for (unsigned i = 0; i < n_threads; i++)
     {
@@ -37,6 +43,14 @@ std::shared_ptr<fastLEC::Task> fastLEC::PartitionSAT::pick_split_task()
             if (task->split_ct() >= max_split)
                 continue;
 
+            // a racer would duplicate the root, which waits for the race
+            if (task->racer || (task->is_root() && racing.load()))
+                continue;
+
+            // the short tasks are solved faster than split
+            if (task->runtime() < min_rt)
+                continue;
+
             // 1
             double score = task->runtime();
             // 2
@@ -67,73 +81,477 @@ std::shared_ptr<fastLEC::Task> fastLEC::PartitionSAT::pick_split_task()
         return target_task;
 }
 
+// a member of an XOR chain scores by the chain size, its distances and
+// whether it is a cut point of the chain
+static double base_score(const fastLEC::SplitScores &s, int v, double log_n)
+{
+    if (s.chain_of[v] < 0)
+        return 1.0;
+
+    double alpha = 0.6;
+    double dis = alpha * s.odis[v] + (1 - alpha) * s.idis[v] + 1.0;
+    double score = std::pow(s.chain_size[s.chain_of[v]], 2.0) * log_n / dis;
+    if (s.important[v])
+        score *= 5.0;
+    return score;
+}
+
+// the score of v averaged with its unmasked fanins and fanouts
+static double average_score(const fastLEC::XAG &xag,
+                            const std::vector<bool> &mask,
+                            const std::vector<double> &src,
+                            int v)
+{
+    if (mask[v])
+        return src[v];
+
+    double beta = 10.0;
+    double sum = 0.0;
+    double cnt = 0;
+    for (auto u : xag.v_usr[v])
+    {
+        if (!mask[u])
+        {
+            sum += src[u];
+            cnt += 1;
+        }
+    }
+    int i1 = fastLEC::aiger_var(xag.gates[v].inputs[0]);
+    int i2 = fastLEC::aiger_var(xag.gates[v].inputs[1]);
+    if (!mask[i1])
+    {
+        sum += src[i1];
+        cnt += 1;
+    }
+    if (!mask[i2])
+    {
+        sum += src[i2];
+        cnt += 1;
+    }
+    if (cnt == 0) // an isolated variable
+        return src[v];
+
+    sum += beta * cnt * src[v];
+    cnt += beta * cnt;
+    return sum / cnt;
+}
+
+static bool is_gate(const fastLEC::XAG &xag, int v)
+{
+    return xag.gates[v].type == fastLEC::GateType::AND2 ||
+        xag.gates[v].type == fastLEC::GateType::XOR2;
+}
+
+// the rules of XAG::compute_distance for a single variable
+static int input_distance(const fastLEC::XAG &xag,
+                          const std::vector<bool> &mask,
+                          const std::vector<int> &idis,
+                          int v)
+{
+    if (mask[v] || !is_gate(xag, v))
+        return 0;
+
+    int i1 = fastLEC::aiger_var(xag.gates[v].inputs[0]);
+    int i2 = fastLEC::aiger_var(xag.gates[v].inputs[1]);
+    if (!mask[i1] && !mask[i2] && idis[i1] != INT_MAX && idis[i2] != INT_MAX)
+        return std::max(idis[i1], idis[i2]) + 1;
+    else if (idis[i1] != INT_MAX && idis[i2] == INT_MAX)
+        return idis[i1];
+    else if (idis[i1] == INT_MAX && idis[i2] != INT_MAX)
+        return idis[i2];
+    else
+        return INT_MAX;
+}
+
+static int output_distance(const fastLEC::XAG &xag,
+                           const std::vector<bool> &mask,
+                           const std::vector<int> &odis,
+                           int v)
+{
+    if (mask[v])
+        return 0;
+
+    int dis = INT_MAX;
+    for (int u : xag.v_usr[v])
+        if (!mask[u] && odis[u] != INT_MAX)
+            dis = std::min(dis, odis[u] + 1);
+    return dis == INT_MAX ? 0 : dis;
+}
+
 void fastLEC::PartitionSAT::compute_scores(const std::vector<bool> &mask,
                                            std::vector<double> &scores)
 {
+    scores = full_split_scores(mask)->scores;
+}
+
+std::shared_ptr<const fastLEC::SplitScores>
+fastLEC::PartitionSAT::full_split_scores(const std::vector<bool> &mask)
+{
+    n_full_scores++;
+    int n = root_cnf->num_vars;
+    auto s = std::make_shared<SplitScores>();
+    s->mask = mask;
+
     std::vector<std::vector<int>> XOR_chains;
     std::vector<std::vector<int>> important_nodes;
     this->xag->compute_XOR_chains(mask, XOR_chains, important_nodes);
 
     std::vector<int> in_degree;
     std::vector<int> out_degree;
-    std::vector<int> idis;
-    std::vector<int> odis;
-    this->xag->compute_distance(mask, in_degree, out_degree, idis, odis);
-
-    scores.resize(root_cnf->num_vars + 1, 1.0);
+    this->xag->compute_distance(mask, in_degree, out_degree, s->idis, s->odis);
 
+    s->chain_of.assign(n + 1, -1);
+    s->important.assign(n + 1, false);
     for (unsigned i = 0; i < XOR_chains.size(); i++)
     {
+        s->chain_size.push_back(XOR_chains[i].size());
         for (auto v : XOR_chains[i])
+            s->chain_of[v] = i;
+        for (auto v : important_nodes[i])
+            s->important[v] = true;
+    }
+
+    double log_n = log2(n);
+    s->base.resize(n + 1);
+    for (int v = 0; v <= n; v++)
+        s->base[v] = base_score(*s, v, log_n);
+
+    s->avg = s->base;
+    for (int v = 1; v <= n; v++)
+        s->avg[v] = average_score(*xag, mask, s->base, v);
+    s->scores = s->avg;
+    for (int v = 1; v <= n; v++)
+        s->scores[v] = average_score(*xag, mask, s->avg, v);
+
+    return s;
+}
+
+std::shared_ptr<const fastLEC::SplitScores>
+fastLEC::PartitionSAT::update_split_scores(
+    const std::shared_ptr<const SplitScores> &prev,
+    const std::vector<bool> &mask)
+{
+    int n = root_cnf->num_vars;
+    std::vector<int> assigned; // the newly assigned variables
+    for (int v = 1; v <= n; v++)
+    {
+        if (prev->mask[v] && !mask[v]) // not an extension of prev
+            return full_split_scores(mask);
+        if (mask[v] && !prev->mask[v])
+            assigned.push_back(v);
+    }
+    n_upd_scores++;
+    if (assigned.empty())
+        return prev;
+
+    auto s = std::make_shared<SplitScores>(*prev);
+    s->mask = mask;
+
+    // the variables whose base score is recomputed
+    std::vector<int> changed;
+    std::vector<bool> is_changed(n + 1, false);
+    bool touch_const = false;
+    auto touch = [&](int v)
+    {
+        touch_const = touch_const || v == 0;
+        if (!is_changed[v])
         {
-            double alpha = 0.6;
-            double dis = alpha * odis[v] + (1 - alpha) * idis[v] + 1.0;
-            scores[v] = std::pow(XOR_chains[i].size(), 2.0) *
-                log2(root_cnf->num_vars) / dis;
+            is_changed[v] = true;
+            changed.push_back(v);
         }
-        for (auto v : important_nodes[i])
+    };
+    for (int v : assigned)
+        touch(v);
+
+    // 1. the distances, re-propagated in topological order from the
+    // assigned variables until they stay unchanged
+    std::vector<bool> queued(n + 1, false);
+    {
+        std::priority_queue<int, std::vector<int>, std::greater<int>> q;
+        auto push = [&](int v)
         {
-            scores[v] *= 5.0;
+            if (v > 0 && !queued[v])
+            {
+                queued[v] = true;
+                q.push(v);
+            }
+        };
+        for (int v : assigned)
+        {
+            push(v);
+            for (int u : xag->v_usr[v])
+                push(u);
+        }
+        while (!q.empty())
+        {
+            int v = q.top();
+            q.pop();
+            queued[v] = false;
+            int dis = input_distance(*xag, mask, s->idis, v);
+            if (dis == s->idis[v])
+                continue;
+            s->idis[v] = dis;
+            touch(v);
+            for (int u : xag->v_usr[v])
+                push(u);
+        }
+    }
+    {
+        std::priority_queue<int> q;
+        auto push = [&](int v)
+        {
+            if (v > 0 && !queued[v])
+            {
+                queued[v] = true;
+                q.push(v);
+            }
+        };
+        auto push_fanins = [&](int v)
+        {
+            if (!is_gate(*xag, v))
+                return;
+            push(aiger_var(xag->gates[v].inputs[0]));
+            push(aiger_var(xag->gates[v].inputs[1]));
+        };
+        for (int v : assigned)
+        {
+            push(v);
+            push_fanins(v);
+        }
+        while (!q.empty())
+        {
+            int v = q.top();
+            q.pop();
+            queued[v] = false;
+            int dis = output_distance(*xag, mask, s->odis, v);
+            if (dis == s->odis[v])
+                continue;
+            s->odis[v] = dis;
+            touch(v);
+            push_fanins(v);
         }
     }
 
-    int prop_lev = 2;
-    double beta = 10.0;
-    for (int i = 0; i < prop_lev; i++)
+    // 2. a chain with an assigned variable falls apart, its pieces are
+    // reached from the XOR neighbours of the assigned variables
+    std::vector<bool> visited(n + 1, false);
+    std::vector<int> piece, cut_points;
+    auto rebuild = [&](int v)
+    {
+        if (mask[v] || visited[v])
+            return;
+        piece.clear();
+        cut_points.clear();
+        this->xag->collect_XOR_chain(v, mask, visited, piece);
+
+        bool has_xor = false;
+        for (int u : piece)
+            has_xor = has_xor || xag->gates[u].type == GateType::XOR2;
+        int id = -1;
+        if (has_xor)
+        {
+            id = s->chain_size.size();
+            s->chain_size.push_back(piece.size());
+            this->xag->compute_cut_points(piece, cut_points);
+        }
+        for (int u : piece)
+        {
+            s->chain_of[u] = id;
+            s->important[u] = false;
+            touch(u);
+        }
+        for (int u : cut_points)
+            s->important[u] = true;
+    };
+    for (int v : assigned)
     {
-        std::vector<double> score_bac = scores;
-        for (int v = 1; v <= root_cnf->num_vars; v++)
+        if (prev->chain_of[v] < 0)
+            continue;
+        s->chain_of[v] = -1;
+        s->important[v] = false;
+        for (int u : xag->v_usr[v])
+            if (xag->gates[u].type == GateType::XOR2)
+                rebuild(u);
+        if (xag->gates[v].type == GateType::XOR2)
         {
-            if (!mask[v])
+            rebuild(aiger_var(xag->gates[v].inputs[0]));
+            rebuild(aiger_var(xag->gates[v].inputs[1]));
+        }
+    }
+
+    // the constant reaches all the PIs, not worth a region
+    if (touch_const)
+        return full_split_scores(mask);
+
+    // 3. the base scores, then each averaging pass spreads the changes to
+    // the fanins and fanouts
+    double log_n = log2(n);
+    for (int v : changed)
+        s->base[v] = base_score(*s, v, log_n);
+
+    auto expand = [&]()
+    {
+        unsigned size = changed.size();
+        for (unsigned i = 0; i < size; i++)
+        {
+            int v = changed[i];
+            for (int u : xag->v_usr[v])
+                touch(u);
+            if (is_gate(*xag, v))
             {
-                double sum = 0.0;
-                double cnt = 0;
-                for (auto u : this->xag->v_usr[v])
-                {
-                    if (!mask[u])
-                    {
-                        sum += score_bac[u];
-                        cnt += 1;
-                    }
-                }
-                int i1 = aiger_var(this->xag->gates[v].inputs[0]);
-                int i2 = aiger_var(this->xag->gates[v].inputs[1]);
-                if (!mask[i1])
-                {
-                    sum += score_bac[i1];
-                    cnt += 1;
-                }
-                if (!mask[i2])
-                {
-                    sum += score_bac[i2];
-                    cnt += 1;
-                }
-
-                sum += beta * cnt * score_bac[v];
-                cnt += beta * cnt;
-
-                scores[v] = sum / cnt;
+                touch(aiger_var(xag->gates[v].inputs[0]));
+                touch(aiger_var(xag->gates[v].inputs[1]));
             }
         }
+    };
+    expand();
+    for (int v : changed)
+        if (v > 0)
+            s->avg[v] = average_score(*xag, mask, s->base, v);
+    expand();
+    for (int v : changed)
+        if (v > 0)
+            s->scores[v] = average_score(*xag, mask, s->avg, v);
+
+    return s;
+}
+
+bool fastLEC::PartitionSAT::lookahead(fastLEC::Task *father,
+                                      BCPEngine &bcp,
+                                      std::vector<int> &candidates,
+                                      std::vector<int> &units)
+{
+    unsigned k = std::min<unsigned>(
+        std::max(0, fastLEC::Param::get().custom_params.gt_lookahead),
+        candidates.size());
+    if (k == 0)
+        return true;
+
+    unsigned lev = bcp.level();
+    std::vector<double> la_scores(root_cnf->num_vars + 1, 0.0);
+    for (unsigned i = 0; i < k; i++)
+    {
+        int v = candidates[i];
+        if (bcp.is_assigned(v)) // implied by a failed literal
+            continue;
+
+        bool failed[2];
+        unsigned n_props[2];
+        for (int s = 0; s < 2; s++)
+        {
+            unsigned n_trail = bcp.get_trail().size();
+            failed[s] = !bcp.assume({s == 0 ? v : -v});
+            n_props[s] = bcp.get_trail().size() - n_trail;
+            bcp.backtrack(lev);
+        }
+
+        if (failed[0] && failed[1])
+            return false;
+        if (failed[0] || failed[1])
+        {
+            // a failed literal, the opposite one is implied by the cube
+            units.push_back(failed[0] ? -v : v);
+            std::vector<int> clause = {units.back()};
+            for (int l : father->cube)
+                clause.push_back(-l);
+            shared_clauses.export_clause(std::move(clause));
+            if (!bcp.imply(units.back()))
+                return false;
+            continue;
+        }
+        // march-style: both branches should simplify the formula
+        la_scores[v] = (double)n_props[0] * n_props[1];
+    }
+
+    // the probed candidates first, by their lookahead scores, without the
+    // implied variables
+    std::stable_sort(candidates.begin(),
+                     candidates.begin() + k,
+                     [&](int x, int y)
+                     {
+                         return la_scores[x] > la_scores[y];
+                     });
+    if (!units.empty())
+        candidates.erase(std::remove_if(candidates.begin(),
+                                        candidates.end(),
+                                        [&](int v)
+                                        {
+                                            return bcp.is_assigned(v);
+                                        }),
+                         candidates.end());
+    return true;
+}
+
+double fastLEC::PartitionSAT::task_priority(int task_id)
+{
+    Task *task = get_task_by_id(task_id);
+    if (task->state.load() != WAITING)
+        return -1.0;
+
+    // the sons of a refuted task are refuted by prop_task_status(), the
+    // deeper descendants are only refuted here
+    for (int a = task->father; a != ID_NONE; a = all_tasks[a]->father)
+    {
+        if (all_tasks[a]->is_unsat())
+        {
+            task_states waiting = WAITING;
+            if (task->state.compare_exchange_strong(waiting, UNSATISFIABLE))
+                n_preempted++;
+            return -1.0;
+        }
+    }
+
+    // priority considering:
+    // 1. the refuted brothers (a closed group refutes its father)
+    // 2. level (the deeper, the smaller the space)
+    // 3. hardness (the easy tasks close their groups sooner)
+    // 4. waiting time (no task starves)
+    const CustomParams &params = fastLEC::Param::get().custom_params;
+    double closed = 0.0;
+    if (task->bro_cnt > 1)
+    {
+        unsigned n_unsat = 0;
+        for (unsigned i = 0; i < task->bro_cnt; i++)
+        {
+            int bro = task->bro_first + i;
+            if (bro != task_id && all_tasks[bro]->is_unsat())
+                n_unsat++;
+        }
+        closed = (double)n_unsat / (task->bro_cnt - 1);
+    }
+    double age = fastLEC::ResMgr::get().get_runtime() - task->create_time;
+
+    double priority = params.gt_prio_closed * closed +
+        params.gt_prio_level * task->level +
+        params.gt_prio_easy * (1.0 - task->hardness) +
+        params.gt_prio_age * age;
+    return std::max(0.0, priority);
+}
+
+void fastLEC::PartitionSAT::estimate_hardness(
+    BCPEngine &bcp,
+    const std::vector<int> &split_vars,
+    std::vector<double> &hardness)
+{
+    unsigned lev = bcp.level();
+    double n_free = root_cnf->num_vars - (double)bcp.get_trail().size();
+    hardness.assign(1ul << split_vars.size(), 1.0);
+    if (n_free <= 0.0)
+        return;
+
+    for (unsigned cnt = 0; cnt < hardness.size(); cnt++)
+    {
+        std::vector<int> lits;
+        for (unsigned i = 0; i < split_vars.size(); i++)
+            lits.push_back(cnt & (1 << i) ? split_vars[i] : -split_vars[i]);
+
+        // a son refuted by the propagation is the easiest one
+        if (bcp.assume(lits))
+            hardness[cnt] =
+                (root_cnf->num_vars - (double)bcp.get_trail().size()) /
+                n_free;
+        else
+            hardness[cnt] = 0.0;
+        bcp.backtrack(lev);
     }
 }
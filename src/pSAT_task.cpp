@@ -2,66 +2,148 @@
 #include "pSAT_task.hpp"
 
 #include "basic.hpp"
+#include <algorithm>
 #include <iomanip>
 #include <iostream>
+#include <thread>
 
 // ----------------------------------------------------------------------------
-// related to SQueue
+// related to IdQueue
 // ----------------------------------------------------------------------------
 
-template <typename T> bool fastLEC::SQueue<T>::empty() const
+bool fastLEC::IdQueue::empty() const
 {
-    std::lock_guard<std::mutex> lock(_mtx);
-    return q.empty();
+    return head.load(std::memory_order_acquire) >=
+        tail.load(std::memory_order_acquire);
 }
 
-template <typename T> unsigned fastLEC::SQueue<T>::size() const
+unsigned fastLEC::IdQueue::size() const
 {
-    std::lock_guard<std::mutex> lock(_mtx);
-    return q.size();
+    unsigned h = head.load(std::memory_order_acquire);
+    unsigned t = tail.load(std::memory_order_acquire);
+    return t > h ? t - h : 0;
+}
+
+void fastLEC::IdQueue::emplace(int id)
+{
+    unsigned i = tail.fetch_add(1, std::memory_order_acq_rel);
+    slots.at(i).id.store(id, std::memory_order_release);
 }
 
-template <typename T> void fastLEC::SQueue<T>::emplace(T &&item)
+bool fastLEC::IdQueue::try_pop(int &id)
 {
+    unsigned h = head.load(std::memory_order_acquire);
+    while (h < tail.load(std::memory_order_acquire))
     {
-        std::lock_guard<std::mutex> lock(_mtx);
-        q.emplace(std::move(item));
+        if (!head.compare_exchange_weak(h, h + 1, std::memory_order_acq_rel))
+            continue;
+
+        // the producer of a reserved slot is about to fill it
+        Slot &slot = slots.at(h);
+        while ((id = slot.id.load(std::memory_order_acquire)) == INT_MIN)
+            std::this_thread::yield();
+        return true;
     }
-    _cv.notify_one();
+    return false;
 }
 
-template <typename T> T fastLEC::SQueue<T>::pop()
+// ----------------------------------------------------------------------------
+// related to TaskScheduler
+// ----------------------------------------------------------------------------
+
+unsigned fastLEC::TaskScheduler::size() const
 {
-    std::unique_lock<std::mutex> lock(_mtx);
-    _cv.wait(lock,
-             [this]()
-             {
-                 return !q.empty();
-             });
+    if (!priority)
+        return fifo.size();
+    return n.load(std::memory_order_acquire);
+}
 
-    T item = std::move(q.front());
-    q.pop();
-    return item;
+void fastLEC::TaskScheduler::emplace(int id)
+{
+    if (!priority)
+    {
+        fifo.emplace(id);
+        return;
+    }
+    std::lock_guard<std::mutex> lock(_mtx);
+    ids.push_back(id);
+    n.store(ids.size(), std::memory_order_release);
 }
 
-template <typename T> bool fastLEC::SQueue<T>::try_pop(T &item)
+bool fastLEC::TaskScheduler::try_pop(int &id)
 {
+    if (!priority)
+        return fifo.try_pop(id);
+
+    // the dropped ids are removed in the same pass
     std::lock_guard<std::mutex> lock(_mtx);
-    if (q.empty())
+    int best = -1;
+    double best_p = 0.0;
+    unsigned j = 0;
+    for (unsigned i = 0; i < ids.size(); i++)
+    {
+        double p = priority(ids[i]);
+        if (p < 0.0)
+            continue;
+        if (best < 0 || p > best_p)
+        {
+            best = j;
+            best_p = p;
+        }
+        ids[j++] = ids[i];
+    }
+    ids.resize(j);
+    if (best >= 0)
+    {
+        id = ids[best];
+        ids.erase(ids.begin() + best);
+    }
+    n.store(ids.size(), std::memory_order_release);
+    return best >= 0;
+}
+
+// ----------------------------------------------------------------------------
+// related to ClauseChannel
+// ----------------------------------------------------------------------------
+
+bool fastLEC::ClauseChannel::export_clause(std::vector<int> clause)
+{
+    if (clause.empty() || clause.size() > max_size)
         return false;
 
-    item = std::move(q.front());
-    q.pop();
+    std::sort(clause.begin(), clause.end());
+    clause.erase(std::unique(clause.begin(), clause.end()), clause.end());
+
+    std::lock_guard<std::shared_mutex> lock(_mtx);
+    if (!seen.insert(clause).second)
+        return false;
+    lits.insert(lits.end(), clause.begin(), clause.end());
+    ends.push_back(lits.size());
     return true;
 }
 
+void fastLEC::ClauseChannel::snapshot(std::vector<int> &res_lits,
+                                      std::vector<int> &res_end_pos) const
+{
+    std::shared_lock<std::shared_mutex> lock(_mtx);
+    res_lits = lits;
+    res_end_pos = ends;
+}
+
+unsigned fastLEC::ClauseChannel::size() const
+{
+    std::shared_lock<std::shared_mutex> lock(_mtx);
+    return ends.size();
+}
+
 // ----------------------------------------------------------------------------
 // Task class implementation
 // ----------------------------------------------------------------------------
 
 fastLEC::Task::Task()
     : state(WAITING), id(ID_NONE), cpu(CPU_NONE), new_cube_lit_cnt(0),
-      father(ID_NONE), level(0)
+      father(ID_NONE), level(0), racer(false), config(-1), remote(false),
+      bro_first(ID_NONE), bro_cnt(0), hardness(1.0)
 {
     is_propagated = false;
 
@@ -141,5 +223,32 @@ std::ostream &fastLEC::operator<<(std::ostream &os, const Task &t)
     return os;
 }
 
-// Explicit template instantiation for SQueue<int>
-template class fastLEC::SQueue<int>;
\ No newline at end of file
+// ----------------------------------------------------------------------------
+// related to TaskArena
+// ----------------------------------------------------------------------------
+
+int fastLEC::TaskArena::emplace_back(const std::function<void(Task &)> &init)
+{
+    std::lock_guard<std::mutex> lock(append_mtx);
+    unsigned id = n.load(std::memory_order_relaxed);
+    Task &task = tasks.at(id);
+    task.id = id;
+    init(task);
+    n.store(id + 1, std::memory_order_release);
+    return id;
+}
+
+int fastLEC::TaskArena::emplace_group(
+    unsigned n_tasks, const std::function<void(Task &, unsigned)> &init)
+{
+    std::lock_guard<std::mutex> lock(append_mtx);
+    unsigned first = n.load(std::memory_order_relaxed);
+    for (unsigned i = 0; i < n_tasks; i++)
+    {
+        Task &task = tasks.at(first + i);
+        task.id = first + i;
+        init(task, i);
+        n.store(first + i + 1, std::memory_order_release);
+    }
+    return first;
+}
@@ -1,28 +1,158 @@
 #pragma once
 
-#include <queue>
+#include <set>
+#include <climits>
+#include <functional>
+#include <mutex>
 #include <atomic>
+#include <memory>
 #include <vector>
+#include <shared_mutex>
 #include <condition_variable>
 
 namespace fastLEC
 {
 
 // ----------------------------------------------------------------------------
-// Safe Queue
+// Stable Array
 // ----------------------------------------------------------------------------
-template <typename T> class SQueue
+// an append-only array of chunks with doubling sizes: the elements never
+// move, and a missing chunk is installed by a CAS, so the access is lock-free
+template <typename T> class StableArray
 {
-    std::queue<T> q;
-    mutable std::mutex _mtx;
-    std::condition_variable _cv;
+    static const unsigned base = 64; // the size of the first chunk
+    static const unsigned max_chunks = 26;
+    std::atomic<T *> chunks[max_chunks];
+
+    static unsigned chunk_of(unsigned i)
+    {
+        return 31 - __builtin_clz(i / base + 1);
+    }
+
+public:
+    StableArray()
+    {
+        for (auto &c : chunks)
+            c.store(nullptr, std::memory_order_relaxed);
+    }
+    ~StableArray()
+    {
+        for (auto &c : chunks)
+            delete[] c.load(std::memory_order_relaxed);
+    }
+    StableArray(const StableArray &) = delete;
+    StableArray &operator=(const StableArray &) = delete;
+
+    // the element i, its chunk is allocated if needed
+    T &at(unsigned i)
+    {
+        unsigned c = chunk_of(i);
+        T *chunk = chunks[c].load(std::memory_order_acquire);
+        if (chunk == nullptr)
+        {
+            T *fresh = new T[base << c];
+            if (chunks[c].compare_exchange_strong(chunk, fresh))
+                chunk = fresh;
+            else
+                delete[] fresh; // installed by another thread
+        }
+        return chunk[i - base * ((1u << c) - 1)];
+    }
+    // the element i of an allocated chunk
+    T &operator[](unsigned i) const
+    {
+        unsigned c = chunk_of(i);
+        T *chunk = chunks[c].load(std::memory_order_acquire);
+        return chunk[i - base * ((1u << c) - 1)];
+    }
+};
+
+// ----------------------------------------------------------------------------
+// Id Queue
+// ----------------------------------------------------------------------------
+// a lock-free MPMC queue of task ids: a producer reserves the tail slot and
+// fills it, a consumer claims the head slot by a CAS. the slots are not
+// reused, each task id is queued a bounded number of times.
+class IdQueue
+{
+    struct Slot
+    {
+        std::atomic<int> id{INT_MIN}; // INT_MIN: reserved, not filled yet
+    };
+    StableArray<Slot> slots;
+    std::atomic<unsigned> head{0}, tail{0};
 
 public:
     bool empty() const;
     unsigned size() const;
-    void emplace(T &&item);
-    bool try_pop(T &item);
-    T pop();
+    void emplace(int id);
+    bool try_pop(int &id);
+};
+
+// ----------------------------------------------------------------------------
+// Task Scheduler
+// ----------------------------------------------------------------------------
+// the pool of the waiting task ids. without a priority it is a lock-free
+// FIFO. with one it is popped by priority: the pool holds the tasks not
+// started yet, a few per worker, so a pop scans it under a lock.
+class TaskScheduler
+{
+    IdQueue fifo;
+    std::function<double(int)> priority;
+    std::vector<int> ids; // in the order of the pushes, with a priority
+    std::atomic<unsigned> n{0};
+    mutable std::mutex _mtx;
+
+public:
+    // set before the first push. the ids of a negative priority are
+    // dropped by the pops.
+    void set_priority(std::function<double(int)> p) { priority = std::move(p); }
+
+    bool empty() const { return size() == 0; }
+    unsigned size() const;
+    void emplace(int id);
+    // the id of the highest priority, the oldest one on a tie
+    bool try_pop(int &id);
+};
+
+// ----------------------------------------------------------------------------
+// Clause Channel
+// ----------------------------------------------------------------------------
+// the clauses implied by the root CNF, exported by the tasks and imported by
+// the new ones. a clause derived under a cube carries the negated cube, so
+// it is independent of the cube. the short clauses are kept, once each.
+class ClauseChannel
+{
+    std::vector<int> lits, ends; // the layout of the CNF clauses
+    std::set<std::vector<int>> seen;
+    mutable std::shared_mutex _mtx;
+
+public:
+    unsigned max_size = 0;
+
+    // return false if the clause is too long or already shared
+    bool export_clause(std::vector<int> clause);
+    void snapshot(std::vector<int> &res_lits,
+                  std::vector<int> &res_end_pos) const;
+    unsigned size() const;
+};
+
+// ----------------------------------------------------------------------------
+// Split Scores
+// ----------------------------------------------------------------------------
+// the structural analyses behind the split scores under a mask, kept by the
+// split task and inherited by its sons: a son only updates the region of the
+// variables newly assigned by its cube.
+struct SplitScores
+{
+    std::vector<bool> mask;           // the assigned variables
+    std::vector<int> chain_of;        // the XOR chain of a variable, or -1
+    std::vector<unsigned> chain_size; // indexed by chain
+    std::vector<bool> important;      // the cut points of the chains
+    std::vector<int> idis, odis;      // distance to inputs / to output
+    std::vector<double> base;         // before the averaging passes
+    std::vector<double> avg;          // after the first averaging pass
+    std::vector<double> scores;       // after the second averaging pass
 };
 
 // ----------------------------------------------------------------------------
@@ -84,6 +214,18 @@ public:
     unsigned split_ct() const { return sons.size(); }
 
     unsigned level;
+    bool racer;  // a copy of the root, racing with another configuration
+    int config;  // the solver preset of the worker, -1 if not run
+    bool remote; // exported, solved by another process
+
+    // the sons of a split have consecutive ids: bro_first .. + bro_cnt - 1
+    int bro_first;
+    unsigned bro_cnt;
+    double hardness; // the variables left free by the cube, in [0, 1]
+
+    // the scores of the last split, or the ones of the father. read and
+    // written with std::atomic_load / std::atomic_store.
+    std::shared_ptr<const SplitScores> split_scores;
 
     void terminate_info_upd();
 
@@ -101,4 +243,46 @@ public:
 };
 std::ostream &operator<<(std::ostream &os, const Task &t);
 
+// ----------------------------------------------------------------------------
+// Task Arena
+// ----------------------------------------------------------------------------
+// all the tasks, indexed by id. a task is initialized before it is published
+// by the size, then its address stays valid: the readers need no lock and no
+// reference count. the appends are serialized.
+class TaskArena
+{
+    StableArray<Task> tasks;
+    std::atomic<unsigned> n{0};
+    std::mutex append_mtx;
+
+public:
+    // append a task initialized by init, return its id
+    int emplace_back(const std::function<void(Task &)> &init);
+    // append n tasks with consecutive ids, the i-th is initialized by
+    // init(task, i). return the first id.
+    int emplace_group(unsigned n_tasks,
+                      const std::function<void(Task &, unsigned)> &init);
+    unsigned size() const { return n.load(std::memory_order_acquire); }
+    Task *operator[](int id) const { return &tasks[id]; }
+
+    class iterator
+    {
+        const TaskArena *arena;
+        unsigned i;
+
+    public:
+        iterator(const TaskArena *arena, unsigned i) : arena(arena), i(i) {}
+        Task *operator*() const { return (*arena)[i]; }
+        iterator &operator++()
+        {
+            i++;
+            return *this;
+        }
+        bool operator!=(const iterator &o) const { return i != o.i; }
+    };
+    // the tasks published when the loop starts
+    iterator begin() const { return iterator(this, 0); }
+    iterator end() const { return iterator(this, size()); }
+};
+
 } // namespace fastLEC
\ No newline at end of file
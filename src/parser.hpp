@@ -29,6 +29,7 @@ enum engines
     X(pBDD)                                                                    \
     X(SAT)                                                                     \
     X(pSAT)                                                                    \
+    X(mpi_pSAT)                                                                \
     X(gpuES)                                                                   \
     X(SAT_sweeping)                                                            \
     X(BDD_sweeping)                                                            \
@@ -54,6 +55,19 @@ enum engines
                int,                                                            \
                17,                                                             \
                "bitvector width in log scale for logic synthesis")             \
+    USER_PARAM(ls_ies,                                                         \
+               bool,                                                           \
+               true,                                                           \
+               "Simulate on the observing iES program in logic synthesis")     \
+    USER_PARAM(ls_chunk_bits,                                                  \
+               int,                                                            \
+               12,                                                             \
+               "chunk width in log scale for streaming logic simulation")      \
+    USER_PARAM(ls_target_size,                                                 \
+               int,                                                            \
+               2,                                                              \
+               "min class size for targeted patterns, 0: off")                 \
+    USER_PARAM(ls_target_rounds, int, 8, "rounds of targeted patterns")        \
     USER_PARAM(es_bv_bits,                                                     \
                int,                                                            \
                14,                                                             \
@@ -69,11 +83,103 @@ enum engines
     USER_PARAM(log_sub_cnfs, bool, false, "Log the CNFs of sub-graphs")        \
     USER_PARAM(log_features, bool, false, "Log the features of XAG")           \
     USER_PARAM(vis, bool, false, "visualize the log files")                    \
+    USER_PARAM(sw_budget,                                                      \
+               double,                                                         \
+               0.0,                                                            \
+               "Initial time slice (s) of a sweeping sub-problem, 0: none")    \
+    USER_PARAM(sw_budget_growth, double, 4.0, "Budget growth of sweep retry")  \
+    USER_PARAM(sw_max_retry, int, 3, "Max retries of a sweeping sub-problem")  \
+    USER_PARAM(sw_conflicts,                                                   \
+               int,                                                            \
+               0,                                                              \
+               "Initial conflict limit of a SAT sub-problem, 0: none")         \
+    USER_PARAM(sw_spec,                                                        \
+               int,                                                            \
+               0,                                                              \
+               "Max rounds of speculative reduction before sweeping, 0: off")  \
+    USER_PARAM(sw_prefetch,                                                    \
+               int,                                                            \
+               4,                                                              \
+               "Sub-graphs prepared ahead on a helper thread, 0: off")         \
+    USER_PARAM(sw_passes,                                                      \
+               int,                                                            \
+               1,                                                              \
+               "Max sweeping passes, each on the graph reduced by the last")   \
+    USER_PARAM(sw_odc_levels,                                                  \
+               int,                                                            \
+               0,                                                              \
+               "Window levels of ODC-aware merging, 0: off")                   \
+    USER_PARAM(sw_cut_size,                                                    \
+               int,                                                            \
+               6,                                                              \
+               "Leaves of the cuts proving the candidate pairs (2-8), 0: off") \
+    USER_PARAM(sw_cut_num, int, 8, "Max priority cuts kept per node")          \
+    USER_PARAM(sw_struct_match,                                                \
+               int,                                                            \
+               3,                                                              \
+               "Local hash depth of matching the miter halves, 0: off")        \
+    USER_PARAM(iso_reuse, bool, true, "Reuse results of isomorphic subgraphs") \
+    USER_PARAM(proof_cache,                                                    \
+               std::string,                                                    \
+               "",                                                             \
+               "Persistent proof cache file for sweeping (off if empty)")      \
     USER_PARAM(log_dir, std::string, "./", "Log directory")                    \
     USER_PARAM(log_items_per_line, int, 2, "Number of items per line in log")  \
     USER_PARAM(prt_cpu_t_interval, double, 50.0, "Time interval for printing") \
     USER_PARAM(                                                                \
         prt_alltask_interval, int, 50, "Task number interval for printing")    \
+    USER_PARAM(gt_reduce_cnf,                                                  \
+               bool,                                                           \
+               true,                                                           \
+               "Load the CNF reduced under the cube of a task")                \
+    USER_PARAM(gt_split_delay,                                                 \
+               double,                                                         \
+               0.1,                                                            \
+               "Runtime of a task before it can be split (seconds)")           \
+    USER_PARAM(gt_lookahead,                                                   \
+               int,                                                            \
+               32,                                                             \
+               "Candidates probed by lookahead for a split, 0: off")           \
+    USER_PARAM(gt_share_size,                                                  \
+               int,                                                            \
+               8,                                                              \
+               "Max size of the clauses shared by the tasks, 0: off")          \
+    USER_PARAM(gt_diversify,                                                   \
+               bool,                                                           \
+               true,                                                           \
+               "Diversify the solver configurations of the workers")           \
+    USER_PARAM(gt_portfolio,                                                   \
+               int,                                                            \
+               0,                                                              \
+               "Configurations racing on the root before a split, 0: off")     \
+    USER_PARAM(gt_portfolio_time,                                              \
+               double,                                                         \
+               1.0,                                                            \
+               "Runtime of the portfolio race (seconds)")                      \
+    USER_PARAM(gt_conflicts,                                                   \
+               int,                                                            \
+               0,                                                              \
+               "Conflict limit of the racing configurations, 0: none")         \
+    USER_PARAM(gt_priority,                                                    \
+               bool,                                                           \
+               true,                                                           \
+               "Schedule the waiting tasks by priority, 0: FIFO")              \
+    USER_PARAM(gt_prio_closed,                                                 \
+               double,                                                         \
+               4.0,                                                            \
+               "Priority weight of the refuted brothers of a task")            \
+    USER_PARAM(gt_prio_level,                                                  \
+               double,                                                         \
+               1.0,                                                            \
+               "Priority weight of the cube depth")                            \
+    USER_PARAM(gt_prio_easy,                                                   \
+               double,                                                         \
+               2.0,                                                            \
+               "Priority weight of the lookahead-estimated ease")              \
+    USER_PARAM(gt_prio_age,                                                    \
+               double,                                                         \
+               1.0,                                                            \
+               "Priority weight of the waiting time (per second)")             \
     USER_PARAM(gt_max_split, int, 1, "Max split times for a task")             \
     USER_PARAM(                                                                \
         gt_level_coefficient, double, 1.5, "Level coefficient for score")      \
@@ -119,6 +225,18 @@ public:
     double timeout;
     CustomParams custom_params;
 
+    // the budget of the current sweeping sub-problem (disabled if <= 0)
+    double budget_deadline;
+    int budget_conflicts;
+
+    // the time limit for the engines: the timeout or the budget deadline
+    double time_limit() const
+    {
+        if (budget_deadline > 0 && budget_deadline < timeout)
+            return budget_deadline;
+        return timeout;
+    }
+
     void init()
     {
         input_file = "";
@@ -126,6 +244,8 @@ public:
         n_threads = 1;
         verbose = 1;
         timeout = 3600.0;
+        budget_deadline = -1.0;
+        budget_conflicts = 0;
         custom_params = CustomParams{};
     }
 
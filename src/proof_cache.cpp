@@ -0,0 +1,199 @@
+#include "proof_cache.hpp"
+#include "parser.hpp"
+
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sstream>
+#include <sys/file.h>
+#include <unistd.h>
+
+using namespace fastLEC;
+
+ProofCache::~ProofCache()
+{
+    if (fd >= 0)
+        close(fd);
+}
+
+bool ProofCache::open(const std::string &file_path)
+{
+    path = file_path;
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (fd < 0)
+    {
+        printf("c [ProofCache] failed to open %s: %s\n",
+               path.c_str(),
+               strerror(errno));
+        return false;
+    }
+
+    load_new_entries();
+
+    if (Param::get().verbose > 0)
+    {
+        printf("c [ProofCache] load %zu entries from %s\n",
+               entries.size(),
+               path.c_str());
+        fflush(stdout);
+    }
+    return true;
+}
+
+CacheKey ProofCache::key_of(const fastLEC::XAG &xag)
+{
+    // two independent hash chains over the compacted structure
+    CacheKey key;
+    auto absorb = [&key](uint64_t v)
+    {
+        key.hi = mix64(key.hi ^ v);
+        key.lo = mix64(key.lo + v * 0x9e3779b97f4a7c15ull + 0x632be59bull);
+    };
+
+    absorb(xag.PI.size());
+    absorb(xag.max_var);
+    absorb(xag.PO);
+    for (int v = 1; v <= xag.max_var; v++)
+    {
+        const Gate &g = xag.gates[v];
+        absorb(g.type);
+        if (g.type == GateType::AND2 || g.type == GateType::XOR2)
+        {
+            absorb(g.inputs[0]);
+            absorb(g.inputs[1]);
+        }
+    }
+    return key;
+}
+
+bool ProofCache::parse_line(const std::string &line)
+{
+    // a cex has one character per PI, so the fields have no length limit
+    std::istringstream iss(line);
+    std::string key_str, res_str, eng_str, cex_str;
+    double time = 0.0;
+    if (!(iss >> key_str >> res_str >> eng_str >> time >> cex_str))
+        return false;
+    if (key_str.size() != 32)
+        return false;
+
+    CacheKey key;
+    const char *key_fmt = "%16" SCNx64 "%16" SCNx64;
+    if (sscanf(key_str.c_str(), key_fmt, &key.hi, &key.lo) != 2)
+        return false;
+
+    CacheEntry entry;
+    if (res_str == "EQ")
+        entry.result = ret_vals::ret_UNS;
+    else if (res_str == "NEQ")
+        entry.result = ret_vals::ret_SAT;
+    else
+        return false;
+    entry.engine = eng_str;
+    entry.time = time;
+    if (cex_str != "-")
+        entry.cex = cex_str;
+
+    entries.emplace(key, entry);
+    return true;
+}
+
+void ProofCache::load_new_entries()
+{
+    if (fd < 0)
+        return;
+
+    flock(fd, LOCK_SH);
+    off_t end = lseek(fd, 0, SEEK_END);
+    std::string buf;
+    if (end > loaded_offset)
+    {
+        buf.resize(end - loaded_offset);
+        ssize_t n = pread(fd, &buf[0], buf.size(), loaded_offset);
+        buf.resize(n > 0 ? n : 0);
+    }
+    flock(fd, LOCK_UN);
+
+    // only consume complete lines, a torn tail is retried next time
+    size_t pos = 0, nl;
+    while ((nl = buf.find('\n', pos)) != std::string::npos)
+    {
+        std::string line = buf.substr(pos, nl - pos);
+        if (!line.empty() && line[0] != 'c')
+        {
+            if (!parse_line(line) && Param::get().verbose > 1)
+                printf("c [ProofCache] skip malformed entry: %s\n",
+                       line.c_str());
+        }
+        pos = nl + 1;
+    }
+    loaded_offset += pos;
+}
+
+bool ProofCache::lookup(const CacheKey &key, CacheEntry &entry)
+{
+    auto it = entries.find(key);
+    if (it == entries.end())
+    {
+        // other processes may have proven it in the meantime
+        load_new_entries();
+        it = entries.find(key);
+    }
+
+    if (it == entries.end())
+    {
+        n_misses++;
+        return false;
+    }
+    n_hits++;
+    entry = it->second;
+    return true;
+}
+
+void ProofCache::store(const CacheKey &key, const CacheEntry &entry)
+{
+    if (fd < 0 || entry.result == ret_vals::ret_UNK)
+        return;
+
+    char head[160];
+    snprintf(head,
+             sizeof(head),
+             "%016" PRIx64 "%016" PRIx64 " %s %s %.4f ",
+             key.hi,
+             key.lo,
+             entry.result == ret_vals::ret_UNS ? "EQ" : "NEQ",
+             entry.engine.empty() ? "unknown" : entry.engine.c_str(),
+             entry.time);
+    std::string line = head;
+    line += entry.cex.empty() ? "-" : entry.cex;
+    line += "\n";
+
+    // a single write() under the exclusive lock keeps the line atomic
+    flock(fd, LOCK_EX);
+    ssize_t n = write(fd, line.data(), line.size());
+    flock(fd, LOCK_UN);
+
+    if (n != (ssize_t)line.size())
+    {
+        printf("c [ProofCache] failed to append to %s\n", path.c_str());
+        return;
+    }
+    entries[key] = entry;
+    n_stores++;
+}
+
+void ProofCache::print_stats() const
+{
+    unsigned n_lookups = n_hits + n_misses;
+    printf("c [ProofCache] lookups: %u, hits: %u (%.1f%%), misses: %u, "
+           "stored: %u, entries: %zu\n",
+           n_lookups,
+           n_hits,
+           n_lookups == 0 ? 0.0 : 100.0 * n_hits / n_lookups,
+           n_misses,
+           n_stores,
+           entries.size());
+    fflush(stdout);
+}
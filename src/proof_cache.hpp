@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "XAG.hpp"
+#include "basic.hpp"
+
+namespace fastLEC
+{
+
+// 128-bit structural key of a (compacted) sub-XAG
+struct CacheKey
+{
+    uint64_t hi = 0, lo = 0;
+
+    bool operator==(const CacheKey &rhs) const
+    {
+        return hi == rhs.hi && lo == rhs.lo;
+    }
+};
+
+struct CacheKeyHash
+{
+    size_t operator()(const CacheKey &k) const { return k.hi ^ (k.lo << 1); }
+};
+
+struct CacheEntry
+{
+    fastLEC::ret_vals result = ret_vals::ret_UNK; // ret_UNS (EQ) or ret_SAT
+    std::string engine;                           // the engine that proved it
+    double time = 0.0;                            // the proving time
+    std::string cex; // PI values ('0'/'1') of the counterexample, maybe empty
+};
+
+// Persistent proof cache for sweeping sub-problems.
+// ----------------------------------------------------------------------------
+// an append-only text log, one entry per line:
+//   <key:32 hex> <EQ|NEQ> <engine> <time> <cex|->
+// the writers append under an exclusive flock, the readers load the complete
+// lines under a shared flock, so that processes on the same host can share
+// one file. on a miss, the entries appended by others are reloaded.
+class ProofCache
+{
+    std::string path;
+    int fd = -1;
+    off_t loaded_offset = 0; // the file is loaded up to this offset
+
+    std::unordered_map<CacheKey, CacheEntry, CacheKeyHash> entries;
+
+    void load_new_entries();
+    bool parse_line(const std::string &line);
+
+public:
+    unsigned n_hits = 0, n_misses = 0, n_stores = 0;
+
+    ProofCache() = default;
+    ~ProofCache();
+    ProofCache(const ProofCache &) = delete;
+    ProofCache &operator=(const ProofCache &) = delete;
+
+    bool open(const std::string &file_path);
+    bool is_open() const { return fd >= 0; }
+
+    static CacheKey key_of(const fastLEC::XAG &xag);
+
+    bool lookup(const CacheKey &key, CacheEntry &entry);
+    void store(const CacheKey &key, const CacheEntry &entry);
+
+    void print_stats() const;
+};
+
+} // namespace fastLEC
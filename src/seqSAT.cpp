@@ -11,7 +11,8 @@ extern "C"
 #include "../deps/kissat/src/kissat.h"
 }
 
-ret_vals fastLEC::Prover::seq_SAT_kissat(std::shared_ptr<fastLEC::CNF> cnf)
+ret_vals fastLEC::Prover::seq_SAT_kissat(std::shared_ptr<fastLEC::CNF> cnf,
+                                         std::vector<int> *model)
 {
     if (!cnf)
     {
@@ -41,8 +42,11 @@ ret_vals fastLEC::Prover::seq_SAT_kissat(std::shared_ptr<fastLEC::CNF> cnf)
         kissat_add(solver.get(), 0);
     }
 
+    if (Param::get().budget_conflicts > 0)
+        kissat_set_conflict_limit(solver.get(), Param::get().budget_conflicts);
+
     double time_resource =
-        Param::get().timeout - fastLEC::ResMgr::get().get_runtime();
+        Param::get().time_limit() - fastLEC::ResMgr::get().get_runtime();
     if (Param::get().custom_params.log_sub_aiger ||
         Param::get().custom_params.log_sub_cnfs ||
         Param::get().custom_params.log_features)
@@ -82,5 +86,12 @@ ret_vals fastLEC::Prover::seq_SAT_kissat(std::shared_ptr<fastLEC::CNF> cnf)
                fastLEC::ResMgr::get().get_runtime() - start_time);
     }
 
+    if (model != nullptr && ret == ret_vals::ret_SAT)
+    {
+        model->assign(cnf->num_vars + 1, 0);
+        for (int v = 1; v <= cnf->num_vars; v++)
+            (*model)[v] = kissat_value(solver.get(), v);
+    }
+
     return ret_vals(ret);
 }
\ No newline at end of file
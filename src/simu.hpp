@@ -13,7 +13,7 @@ namespace fastLEC
 class ISimulator
 {
 public:
-    glob_ES glob_es;
+    glob_ES glob_es = {};
 
     const uint16_t const0_addr = 0;
     const uint16_t const1_addr = 1;
@@ -28,14 +28,29 @@ public:
             free(glob_es.ops);
     }
 
-    void init_glob_ES(fastLEC::XAG &xag);
+    // the observing program (observe = true) also saves the value of every
+    // PI and gate, in the order of obs_vars. with active (indexed by var),
+    // only the active gates are compiled and the PO is not checked. return
+    // false if the program needs more than 2^16 memory addresses.
+    bool init_glob_ES(fastLEC::XAG &xag,
+                      bool observe = false,
+                      const std::vector<bool> *active = nullptr);
     void init_gpu_ES(fastLEC::XAG &xag, glob_ES **ges);
+    std::vector<int> obs_vars;
 
     void prt_bvec(bvec_t *vec);
     void prt_op(operation *op);
 
     fastLEC::ret_vals run_ies_round(uint64_t r);
     fastLEC::ret_vals run_ies();
+
+    // run the observing program on n_words words of patterns: pi_vals[i *
+    // n_words + w] is the w-th word of the i-th PI, obs[k * n_words + w]
+    // gets the value of obs_vars[k]. return ret_SAT if the PO is hit.
+    fastLEC::ret_vals run_observe(const bvec_t *pi_vals,
+                                  unsigned n_words,
+                                  bvec_t *obs,
+                                  unsigned n_threads = 1);
 };
 
 // the origin ES method in hybrid-CEC
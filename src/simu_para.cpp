@@ -36,7 +36,8 @@ fastLEC::ret_vals fastLEC::Simulator::run_pbits_pes(unsigned n_t)
     std::atomic<unsigned long long> found_sat_round(0);
     std::atomic<bool> cutted(false);
 
-    double time_resources = Param::get().timeout - ResMgr::get().get_runtime();
+    double time_resources =
+        Param::get().time_limit() - ResMgr::get().get_runtime();
 
     auto worker = [&](uint64_t para_idx)
     {
@@ -166,7 +167,8 @@ fastLEC::ret_vals fastLEC::Simulator::run_round_pes(unsigned n_t)
     std::atomic<unsigned long long> found_sat_round(0);
     std::atomic<bool> cutted(false);
 
-    double time_resources = Param::get().timeout - ResMgr::get().get_runtime();
+    double time_resources =
+        Param::get().time_limit() - ResMgr::get().get_runtime();
 
     auto worker =
         [&](unsigned long long start_round, unsigned long long end_round)
@@ -7,6 +7,7 @@
 #include <cassert>
 #include <cstring>
 #include <inttypes.h>
+#include <thread>
 
 using namespace fastLEC;
 
@@ -48,18 +49,28 @@ void fastLEC::ISimulator::prt_op(operation *op)
         printf("UNKNOWN \n");
 }
 
-void fastLEC::ISimulator::init_glob_ES(fastLEC::XAG &xag)
+bool fastLEC::ISimulator::init_glob_ES(fastLEC::XAG &xag,
+                                       bool observe,
+                                       const std::vector<bool> *active)
 {
+    auto is_active = [&](const fastLEC::Gate &gate)
+    {
+        return (gate.type == fastLEC::GateType::AND2 ||
+                gate.type == fastLEC::GateType::XOR2) &&
+            (active == nullptr || (*active)[aiger_var(gate.output)]);
+    };
+
 
     std::vector<unsigned> ref_cts(2 * (xag.max_var + 1), 0);
     std::vector<unsigned> mem_addr(2 * (xag.max_var + 1), NOT_ALLOC);
     unsigned max_mems = 0;
     std::vector<unsigned> free_mems_stack;
     std::vector<operation> ops;
+    obs_vars.clear();
 
     std::function<unsigned(void)> alloc_mem = [&]() -> unsigned
     {
-        assert(max_mems <= UINT16_MAX);
+        assert(observe || max_mems <= UINT16_MAX);
         if (free_mems_stack.empty())
             return max_mems++;
         unsigned addr = free_mems_stack.back();
@@ -75,8 +86,7 @@ void fastLEC::ISimulator::init_glob_ES(fastLEC::XAG &xag)
     // Calculate reference counts
     for (auto &gate : xag.gates)
     {
-        if (gate.type == fastLEC::GateType::AND2 ||
-            gate.type == fastLEC::GateType::XOR2)
+        if (is_active(gate))
         {
             unsigned rhs0 = gate.inputs[0];
             unsigned rhs1 = gate.inputs[1];
@@ -84,7 +94,8 @@ void fastLEC::ISimulator::init_glob_ES(fastLEC::XAG &xag)
             ref_cts[rhs1]++;
         }
     }
-    int olit = xag.PO;
+    // a partial program does not check the PO, it reads the constant 0
+    int olit = active == nullptr ? xag.PO : 0;
     ref_cts[olit]++;
 
     // considering not gates
@@ -103,7 +114,7 @@ void fastLEC::ISimulator::init_glob_ES(fastLEC::XAG &xag)
     for (unsigned i = 0; i < xag.PI.size(); i++)
     {
         unsigned lit = xag.PI[i];
-        if (ref_cts[lit] == 0)
+        if (ref_cts[lit] == 0 && !observe)
         {
             printf("c [ERROR] ies glb_es construct: input lit=%u not used in "
                    "the circuit\n",
@@ -114,6 +125,20 @@ void fastLEC::ISimulator::init_glob_ES(fastLEC::XAG &xag)
         assert(lit == i + 2);
     }
 
+    auto save = [&](unsigned lit)
+    {
+        operation op;
+        op.type = OP_SAVE;
+        op.addr1 = op.addr3 = 0;
+        op.addr2 = mem_addr[lit];
+        ops.push_back(op);
+        obs_vars.push_back(aiger_var(lit));
+    };
+    if (observe)
+        for (unsigned lit : xag.PI)
+            if (active == nullptr || (*active)[aiger_var(lit)])
+                save(lit);
+
     if (ref_cts[0] == 0)
         free_mems(const0_addr);
     if (ref_cts[1] == 0)
@@ -122,8 +147,7 @@ void fastLEC::ISimulator::init_glob_ES(fastLEC::XAG &xag)
     // Process gates
     for (auto &gate : xag.gates)
     {
-        if (gate.type == fastLEC::GateType::AND2 ||
-            gate.type == fastLEC::GateType::XOR2)
+        if (is_active(gate))
         {
             unsigned rhs0 = gate.inputs[0];
             unsigned rhs1 = gate.inputs[1];
@@ -207,11 +231,13 @@ void fastLEC::ISimulator::init_glob_ES(fastLEC::XAG &xag)
             // printf("--------------------------------\n");
 
             ops.push_back(op);
+            if (observe)
+                save(out);
         }
     }
 
     // Process output
-    unsigned po_lit = xag.PO;
+    unsigned po_lit = olit;
     if (mem_addr[po_lit] == NOT_ALLOC)
     {
         unsigned not_po_lit = aiger_not(po_lit);
@@ -239,6 +265,8 @@ void fastLEC::ISimulator::init_glob_ES(fastLEC::XAG &xag)
 
     for (unsigned i = 0; i < ops.size(); i++)
         glob_es.ops[i] = ops[i];
+
+    return max_mems <= UINT16_MAX + 1;
 }
 
 void fastLEC::ISimulator::init_gpu_ES(fastLEC::XAG &xag, glob_ES **ges)
@@ -370,7 +398,7 @@ fastLEC::ret_vals fastLEC::ISimulator::run_ies()
     for (unsigned long long r = 0; r < round_num; r++)
     {
         if (r % 10000 == 0 &&
-            ResMgr::get().get_runtime() > Param::get().timeout)
+            ResMgr::get().get_runtime() > Param::get().time_limit())
         {
             res = ret_vals::ret_UNK;
             break;
@@ -392,6 +420,87 @@ fastLEC::ret_vals fastLEC::ISimulator::run_ies()
     return res;
 }
 
+fastLEC::ret_vals fastLEC::ISimulator::run_observe(const bvec_t *pi_vals,
+                                                   unsigned n_words,
+                                                   bvec_t *obs,
+                                                   unsigned n_threads)
+{
+    // a block of words per address, so that the inner loops vectorize
+    const unsigned B = 8;
+    unsigned n_blocks = (n_words + B - 1) / B;
+    n_threads = std::max(1u, std::min(n_threads, n_blocks));
+
+    auto worker = [&](unsigned blk_begin, unsigned blk_end, char &hit)
+    {
+        std::vector<bvec_t> mems((size_t)glob_es.mem_sz * B, 0);
+        bvec_t *m = mems.data();
+        for (unsigned blk = blk_begin; blk < blk_end; blk++)
+        {
+            unsigned w0 = blk * B;
+            unsigned nb = std::min(B, n_words - w0);
+
+            for (unsigned b = 0; b < B; b++)
+                m[const0_addr * B + b] = 0ull, m[const1_addr * B + b] = ~0ull;
+            for (unsigned i = 0; i < glob_es.PI_num; i++)
+                for (unsigned b = 0; b < B; b++)
+                    m[(i + 2) * B + b] =
+                        b < nb ? pi_vals[(size_t)i * n_words + w0 + b] : 0ull;
+
+            size_t k = 0;
+            for (unsigned i = 0; i < glob_es.n_ops; i++)
+            {
+                const operation &op = glob_es.ops[i];
+                bvec_t *d = m + op.addr1 * B;
+                const bvec_t *a = m + op.addr2 * B;
+                if (op.type == OP_AND)
+                {
+                    const bvec_t *c = m + op.addr3 * B;
+                    for (unsigned b = 0; b < B; b++)
+                        d[b] = a[b] & c[b];
+                }
+                else if (op.type == OP_XOR)
+                {
+                    const bvec_t *c = m + op.addr3 * B;
+                    for (unsigned b = 0; b < B; b++)
+                        d[b] = a[b] ^ c[b];
+                }
+                else if (op.type == OP_NOT)
+                {
+                    for (unsigned b = 0; b < B; b++)
+                        d[b] = ~a[b];
+                }
+                else
+                    memcpy(obs + (k++) * n_words + w0, a, nb * sizeof(bvec_t));
+            }
+
+            for (unsigned b = 0; b < nb; b++)
+                if (m[glob_es.PO_lit * B + b] != 0ull)
+                    hit = 1;
+        }
+    };
+
+    std::vector<char> hits(n_threads, 0);
+    if (n_threads == 1)
+        worker(0, n_blocks, hits[0]);
+    else
+    {
+        std::vector<std::thread> threads;
+        unsigned per = (n_blocks + n_threads - 1) / n_threads;
+        for (unsigned t = 0; t < n_threads; t++)
+            threads.emplace_back(worker,
+                                 std::min(n_blocks, t * per),
+                                 std::min(n_blocks, (t + 1) * per),
+                                 std::ref(hits[t]));
+        for (auto &th : threads)
+            th.join();
+    }
+
+    for (char h : hits)
+        if (h)
+            return ret_vals::ret_SAT;
+    return ret_vals::ret_UNK;
+}
+
 ret_vals fastLEC::Simulator::run_ies()
 {
     double start_time = ResMgr::get().get_runtime();
@@ -445,7 +554,7 @@ ret_vals fastLEC::Simulator::run_ies()
         {
 
             if (round % 100 == 0 &&
-                ResMgr::get().get_runtime() > Param::get().timeout)
+                ResMgr::get().get_runtime() > Param::get().time_limit())
             {
                 ret = ret_vals::ret_UNK;
                 break;
@@ -538,7 +647,7 @@ ret_vals fastLEC::Simulator::run_es()
     for (; round < round_num; round++)
     {
         if (round % 100 == 0 &&
-            ResMgr::get().get_runtime() > Param::get().timeout)
+            ResMgr::get().get_runtime() > Param::get().time_limit())
         {
             ret = ret_vals::ret_UNK;
             break;
@@ -649,7 +758,7 @@ ret_vals fastLEC::Prover::seq_ES(std::shared_ptr<fastLEC::XAG> xag)
 
 fastLEC::ret_vals fastLEC::Prover::gpu_ES(std::shared_ptr<fastLEC::XAG> xag)
 {
-    remain_time = Param::get().timeout - ResMgr::get().get_runtime();
+    remain_time = Param::get().time_limit() - ResMgr::get().get_runtime();
     fastLEC::Simulator simu(*xag);
     return simu.run_ges();
 }
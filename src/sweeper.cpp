@@ -1,10 +1,14 @@
 #include "fastLEC.hpp"
 #include "parser.hpp"
 #include "basic.hpp"
+#include "cut.hpp"
+#include "simu.hpp"
+#include <climits>
 #include <cstdio>
 #include <iomanip>
 #include <sstream>
 #include <algorithm>
+#include <set>
 #include <string>
 #include <fstream>
 
@@ -13,16 +17,293 @@ using namespace fastLEC;
 void Sweeper::clear()
 {
     next_class_idx = 0;
+    cur_class_idx = 0;
+    cur_attempt = 0;
+    retry_queue.clear();
     class_index.clear();
     eql_classes.clear();
     skip_pairs.clear();
     proved_pairs.clear();
     rejected_pairs.clear();
+    settled.clear();
+    spec_graph = nullptr;
+    stop_preparing();
+    merged_vars.clear();
+    final_deferred = false;
 }
 
 // ---------------------------------------------------
 // logic simulation
 // ---------------------------------------------------
+
+// split the candidate literals by their simulation keys. in the first round
+// all the simulated literals are candidates, later only the class members.
+// the keys are phase-normalized: key_of sets neg if the key is the one of the
+// complement, so that the class keeps the complemented literal. the constant
+// (literal 0) joins the classification to find the constant candidates.
+template <typename Key, typename KeyOf>
+static void refine_classes(unsigned n_lits,
+                           bool first_round,
+                           KeyOf key_of,
+                           std::vector<int> &class_index,
+                           std::vector<std::vector<int>> &eql_classes)
+{
+    std::unordered_map<Key, std::vector<int>> classification;
+    for (unsigned lit = 0; lit < n_lits; lit += 2)
+    {
+        bool neg = false;
+        const Key *key = key_of(lit, neg);
+        if (first_round)
+        {
+            if (key == nullptr)
+                continue;
+        }
+        else
+        {
+            if (class_index[lit] == -1)
+                continue;
+            class_index[lit] = -1;
+        }
+        classification[*key].push_back(neg ? aiger_not(lit) : lit);
+    }
+
+    eql_classes.clear();
+    for (auto &pair : classification)
+    {
+        const auto &indices = pair.second;
+        if (indices.size() <= 1)
+            continue;
+
+        for (auto lit : indices)
+            class_index[aiger_strip(lit)] = eql_classes.size();
+
+        eql_classes.emplace_back(indices);
+    }
+}
+
+// pair each member of a large class with its most similar member of the
+// other miter half: the deepest equal local hash, then the nearest level. the
+// same-half pairs are rarely equivalent, so the class gets at most one pair
+// per member instead of all the pairs. a member without a similar one is
+// paired with the first member of the other half, a member of a class lying
+// in one half with its most similar member of that half.
+static void pair_by_structure(const std::vector<int> &cls,
+                              const std::vector<char> &side,
+                              const std::vector<int> &level,
+                              const std::vector<std::vector<uint64_t>> &hashes,
+                              std::vector<std::vector<int>> &eql_classes)
+{
+    // side 1 and 2 are the exclusive halves, the others match any member
+    auto other_half = [&](int a, int b)
+    {
+        char sa = side[aiger_var(a)], sb = side[aiger_var(b)];
+        return (sa != 1 && sa != 2) || (sb != 1 && sb != 2) || sa != sb;
+    };
+
+    unsigned depth = hashes.size() - 1;
+    std::vector<std::unordered_map<uint64_t, std::vector<int>>> buckets(
+        depth + 1);
+    for (int lit : cls)
+        for (unsigned d = 0; d <= depth; d++)
+            buckets[d][hashes[d][aiger_var(lit)]].push_back(lit);
+
+    // the most similar member of lit, of the other half if cross
+    auto most_similar = [&](int lit, bool cross)
+    {
+        auto accept = [&](int cand)
+        {
+            return cand != lit && (!cross || other_half(lit, cand));
+        };
+        int best = -1;
+        for (int d = depth; d >= 0 && best < 0; d--)
+        {
+            int gap = INT_MAX;
+            for (int cand : buckets[d][hashes[d][aiger_var(lit)]])
+            {
+                if (!accept(cand))
+                    continue;
+                int g =
+                    std::abs(level[aiger_var(lit)] - level[aiger_var(cand)]);
+                if (g < gap)
+                    gap = g, best = cand;
+            }
+        }
+        for (unsigned i = 0; i < cls.size() && best < 0; i++)
+            if (accept(cls[i]))
+                best = cls[i];
+        return best;
+    };
+
+    std::set<std::pair<int, int>> pairs;
+    for (int lit : cls)
+    {
+        int best = most_similar(lit, true);
+        if (best < 0)
+            best = most_similar(lit, false);
+        if (best >= 0)
+            pairs.emplace(std::min(lit, best), std::max(lit, best));
+    }
+
+    // the class order (topological by the first member) is kept
+    for (unsigned i = 0; i < cls.size(); i++)
+        for (unsigned j = i + 1; j < cls.size(); j++)
+            if (pairs.count({std::min(cls[i], cls[j]),
+                             std::max(cls[i], cls[j])}))
+                eql_classes.emplace_back(std::vector<int>{cls[i], cls[j]});
+}
+
+// the random rounds stop when the classes are stable, leaving large false
+// classes. the targeted patterns are one word per round on the observing iES
+// program: a random base pattern and its distance-1 neighbors, each flipping
+// one PI in the support of the large classes, which separates nodes that
+// depend on the flipped PI differently.
+fastLEC::ret_vals fastLEC::Sweeper::targeted_simulation()
+{
+    unsigned min_size = (unsigned)Param::get().custom_params.ls_target_size;
+    unsigned n_words = (unsigned)Param::get().custom_params.ls_target_rounds;
+    if (min_size == 0 || n_words == 0)
+        return ret_vals::ret_UNK;
+    min_size = std::max(min_size, 2u);
+
+    std::vector<unsigned> targets;
+    for (unsigned i = 0; i < eql_classes.size(); i++)
+        if (eql_classes[i].size() >= min_size)
+            targets.push_back(i);
+    if (targets.empty())
+        return ret_vals::ret_UNK;
+
+    ISimulator is;
+    if (!is.init_glob_ES(*this->xag, true))
+    {
+        if (Param::get().verbose > 0)
+            printf("c [logSim] skip targeted patterns: the XAG is too wide\n");
+        return ret_vals::ret_UNK;
+    }
+
+    // the support of the targeted classes
+    const int max_var = this->xag->max_var;
+    std::vector<bool> in_cone(max_var + 1, false);
+    for (unsigned i : targets)
+        for (int lit : eql_classes[i])
+            in_cone[aiger_var(lit)] = true;
+    std::vector<int> support;
+    for (int v = max_var; v > 0; v--)
+    {
+        if (!in_cone[v])
+            continue;
+        const Gate &g = this->xag->gates[v];
+        if (g.type == GateType::AND2 || g.type == GateType::XOR2)
+        {
+            in_cone[aiger_var(g.inputs[0])] = true;
+            in_cone[aiger_var(g.inputs[1])] = true;
+        }
+        else if (g.type == GateType::PI)
+            support.push_back(v);
+    }
+
+    // bit 0 is the base pattern, bit k flips the k-th chosen PI, the bits
+    // left over by a small support are random patterns. the patterns are
+    // laid out by the position of a PI in xag->PI, which keeps the AIG
+    // variables of the used inputs only.
+    unsigned n_pi = this->xag->PI.size();
+    std::vector<unsigned> pi_index(max_var + 1, 0);
+    for (unsigned i = 0; i < n_pi; i++)
+        pi_index[aiger_var(this->xag->PI[i])] = i;
+    std::vector<bvec_t> pi_vals((size_t)n_pi * n_words);
+    for (auto &w : pi_vals)
+        w = ResMgr::get().random_uint64();
+    unsigned n_flips = std::min<size_t>(support.size(), 63);
+    bvec_t rest = n_flips == 63 ? 0ull : ~0ull << (n_flips + 1);
+    for (unsigned w = 0; w < n_words; w++)
+    {
+        for (unsigned k = 0; k < n_flips; k++)
+        {
+            unsigned pos =
+                k + ResMgr::get().random_uint64() % (support.size() - k);
+            std::swap(support[k], support[pos]);
+        }
+        for (int v : support)
+        {
+            bvec_t &word = pi_vals[(size_t)pi_index[v] * n_words + w];
+            word = ((word & 1) ? ~rest : 0ull) | (word & rest);
+        }
+        for (unsigned k = 0; k < n_flips; k++)
+            pi_vals[(size_t)pi_index[support[k]] * n_words + w] ^=
+                1ull << (k + 1);
+    }
+
+    std::vector<bvec_t> obs(is.obs_vars.size() * n_words);
+    if (is.run_observe(pi_vals.data(),
+                       n_words,
+                       obs.data(),
+                       Param::get().n_threads) == ret_vals::ret_SAT)
+    {
+        printf("c [logSim] targeted patterns: Find bugs\n");
+        return ret_vals::ret_SAT;
+    }
+    std::vector<int> row(max_var + 1, -1);
+    for (unsigned k = 0; k < is.obs_vars.size(); k++)
+        row[is.obs_vars[k]] = k;
+
+    auto key_of = [&](int lit) -> uint64_t
+    {
+        uint64_t key = 0;
+        bvec_t neg = aiger_sign(lit) ? ~0ull : 0ull;
+        for (unsigned w = 0; w < n_words; w++)
+        {
+            int r = row[aiger_var(lit)];
+            bvec_t val = r < 0 ? 0ull : obs[(size_t)r * n_words + w];
+            key = mix64(key ^ val ^ neg);
+        }
+        return key;
+    };
+
+    // split the targeted classes, the first part stays in place
+    unsigned n_before = eql_classes.size();
+    unsigned n_split = 0;
+    for (unsigned i : targets)
+    {
+        std::vector<int> cls = std::move(eql_classes[i]);
+        std::vector<std::vector<int>> parts;
+        std::unordered_map<uint64_t, unsigned> part_of;
+        for (int lit : cls)
+        {
+            auto it = part_of.emplace(key_of(lit), parts.size()).first;
+            if (it->second == parts.size())
+                parts.emplace_back();
+            parts[it->second].push_back(lit);
+        }
+        if (parts.size() > 1)
+            n_split++;
+
+        bool first = true;
+        for (auto &part : parts)
+        {
+            if (part.size() <= 1)
+                continue;
+            if (first)
+                eql_classes[i] = std::move(part), first = false;
+            else
+                eql_classes.emplace_back(std::move(part));
+        }
+    }
+    eql_classes.erase(std::remove_if(eql_classes.begin(),
+                                     eql_classes.end(),
+                                     [](const std::vector<int> &cls)
+                                     { return cls.size() <= 1; }),
+                      eql_classes.end());
+
+    if (Param::get().verbose > 0)
+    {
+        printf("c [logSim] targeted patterns split %u classes: %u -> %zu\n",
+               n_split,
+               n_before,
+               eql_classes.size());
+        fflush(stdout);
+    }
+    return ret_vals::ret_UNK;
+}
+
 fastLEC::ret_vals fastLEC::Sweeper::logic_simulation()
 {
     double start_time = ResMgr::get().get_runtime();
@@ -31,97 +312,112 @@ fastLEC::ret_vals fastLEC::Sweeper::logic_simulation()
     this->clear();
     std::vector<int> class_index(2 * (this->xag->max_var + 1), -1);
 
+    // the structural correspondence of the miter halves
+    std::vector<char> side;
+    std::vector<int> level;
+    std::vector<std::vector<uint64_t>> hashes;
+    int match_depth = Param::get().custom_params.sw_struct_match;
+    bool matching = match_depth > 0 && this->xag->miter_halves(side);
+    if (matching)
+    {
+        this->xag->structural_hashes(match_depth, level, hashes);
+        if (Param::get().verbose > 0)
+        {
+            unsigned n_side[4] = {0, 0, 0, 0};
+            for (int v = 1; v <= this->xag->max_var; v++)
+                n_side[(int)side[v]]++;
+            printf("c [Match] miter halves: %u and %u nodes, %u shared\n",
+                   n_side[1],
+                   n_side[2],
+                   n_side[3]);
+            fflush(stdout);
+        }
+    }
+    // a class of two structurally matched nodes of the two halves
+    auto matched_pair = [&](const std::vector<int> &cls)
+    {
+        if (cls.size() != 2 || cls[0] == 0)
+            return false;
+        int v0 = aiger_var(cls[0]), v1 = aiger_var(cls[1]);
+        return side[v0] + side[v1] == 3 && side[v0] != side[v1] &&
+            hashes[match_depth][v0] == hashes[match_depth][v1];
+    };
+
     unsigned pre_round = 0;
     unsigned round = 0;
     unsigned logic_sim_round = (unsigned)Param::get().custom_params.ls_round;
     unsigned bv_width = (unsigned)Param::get().custom_params.ls_bv_bits;
+    unsigned chunk_bits = (unsigned)Param::get().custom_params.ls_chunk_bits;
     for (; round < logic_sim_round; round++)
     {
         // ---------------------------------------------------------------------
         // step 1: perform logic simulation
         // ---------------------------------------------------------------------
-        std::vector<BitVector> states(2 * (this->xag->max_var + 1));
-
-        for (unsigned i = 0; i < this->xag->PI.size(); i++)
+        std::vector<SimSignature> sigs;
+        if (round == 0)
+            ret = this->xag->stream_simulation(bv_width - 1, chunk_bits, sigs);
+        else
         {
-            int lit = this->xag->PI[i];
-            states[lit].resize(1llu << (bv_width - 1));
-            states[lit].random();
-        }
+            // later rounds only re-simulate the fanin cones of the nodes that
+            // are still in a class, the singletons are settled
+            std::vector<bool> active(this->xag->max_var + 1, false);
+            for (auto &cls : eql_classes)
+                for (auto lit : cls)
+                    active[aiger_var(lit)] = true;
 
-        for (auto &gate : this->xag->gates)
-        {
-            if (gate.type == fastLEC::GateType::AND2 ||
-                gate.type == fastLEC::GateType::XOR2)
+            unsigned n_gates = 0, n_active = 0;
+            for (int var = this->xag->max_var; var >= 1; var--)
             {
-                int rhs0 = gate.inputs[0];
-                int rhs1 = gate.inputs[1];
-                if (aiger_sign(rhs0) && states[rhs0].size() == 0)
-                    states[rhs0] = ~states[aiger_not(rhs0)];
-                if (aiger_sign(rhs1) && states[rhs1].size() == 0)
-                    states[rhs1] = ~states[aiger_not(rhs1)];
-                if (gate.type == fastLEC::GateType::AND2)
-                {
-                    states[gate.output] = states[rhs0] & states[rhs1];
-                }
-                else
-                {
-                    states[gate.output] = states[rhs0] ^ states[rhs1];
-                }
-                states[aiger_not(gate.output)] = ~states[gate.output];
+                const Gate &gate = this->xag->gates[var];
+                if (gate.type != GateType::AND2 && gate.type != GateType::XOR2)
+                    continue;
+                n_gates++;
+                if (!active[var])
+                    continue;
+                active[aiger_var(gate.inputs[0])] = true;
+                active[aiger_var(gate.inputs[1])] = true;
+                n_active++;
+            }
+
+            if (Param::get().verbose > 1)
+            {
+                printf("c [logSim] round %d: re-simulate %u / %u gates\n",
+                       round,
+                       n_active,
+                       n_gates);
+                fflush(stdout);
             }
+            ret = this->xag->stream_simulation(
+                bv_width - 1, chunk_bits, sigs, &active);
         }
-        if (states[this->xag->PO].has_one())
-        {
-            ret = ret_vals::ret_SAT;
+        if (ret == ret_vals::ret_SAT)
             break;
-        }
 
         // ---------------------------------------------------------------------
         // step 2: perform classification
         // ---------------------------------------------------------------------
-
-        std::unordered_map<BitVector, std::vector<int>> classification;
-        classification.clear();
-        if (round == 0)
-        {
-            for (unsigned lit = 2; lit < states.size(); lit += 2)
+        unsigned n_lits = 2 * (this->xag->max_var + 1);
+        refine_classes<SimSignature>(
+            n_lits,
+            round == 0,
+            [&](unsigned lit, bool &neg) -> const SimSignature *
             {
-                if (states[lit].size() == 0)
-                    continue;
-
-                classification[states[lit]].push_back(lit);
-            }
-        }
-        else
-        {
-            for (unsigned lit = 2; lit < states.size(); lit += 2)
-            {
-                if (class_index[lit] == -1)
-                    continue;
-
-                class_index[lit] = -1;
-                classification[states[lit]].push_back(lit);
-            }
-        }
-
-        eql_classes.clear();
-        for (auto &pair : classification)
-        {
-            const auto &indices = pair.second;
-            if (indices.size() <= 1)
-                continue;
-
-            for (auto lit : indices)
-                class_index[lit] = eql_classes.size();
-
-            eql_classes.emplace_back(indices);
-        }
+                const SimSignature &sig = sigs[aiger_var(lit)];
+                neg = sig.phase;
+                return sig.valid ? &sig : nullptr;
+            },
+            class_index,
+            eql_classes);
 
         if (round > 0)
         {
             if (pre_round == eql_classes.size())
                 break;
+            // no more rounds to split the structural correspondences
+            if (matching && std::all_of(eql_classes.begin(),
+                                        eql_classes.end(),
+                                        matched_pair))
+                break;
         }
         pre_round = eql_classes.size();
     }
@@ -132,6 +428,10 @@ fastLEC::ret_vals fastLEC::Sweeper::logic_simulation()
         return ret;
     }
 
+    ret = this->targeted_simulation();
+    if (ret == ret_vals::ret_SAT)
+        return ret;
+
     printf(
         "c [logSim] round %d: Find %lu classes\n", round, eql_classes.size());
 
@@ -143,14 +443,40 @@ fastLEC::ret_vals fastLEC::Sweeper::logic_simulation()
     int tmp_ct = 0;
     auto tmp_eql_classes = eql_classes;
     eql_classes.clear();
+    int po_var = aiger_var(this->xag->PO);
     for (auto &cls : tmp_eql_classes)
     {
+        if (cls[0] == 0 && po_var > 0)
+        {
+            // the PO is the root of the final check, not a constant
+            // candidate
+            cls.erase(std::remove_if(cls.begin(),
+                                     cls.end(),
+                                     [&](int lit)
+                                     {
+                                         return aiger_var(lit) == po_var;
+                                     }),
+                      cls.end());
+            if (cls.size() < 2)
+                continue;
+        }
+
         printf("c [class %5d] vars:", ++tmp_ct);
         for (auto &lit : cls)
             printf(" %d", lit / 2);
         std::cout << std::endl;
 
-        if (cls.size() > 2)
+        if (cls.size() > 2 && cls[0] == 0)
+        {
+            // constant candidates are only paired with the constant
+            for (unsigned j = 1; j < cls.size(); j++)
+                eql_classes.emplace_back(std::vector<int>{0, cls[j]});
+        }
+        else if (cls.size() > 2 && matching)
+        {
+            pair_by_structure(cls, side, level, hashes, eql_classes);
+        }
+        else if (cls.size() > 2)
         {
             for (unsigned i = 0; i < cls.size() - 1; i++)
             {
@@ -225,6 +551,11 @@ fastLEC::ret_vals fastLEC::Sweeper::logic_simulation()
             {
                 int v1 = eql_classes[j][0];
                 int v2 = eql_classes[j][1];
+                // only the same-phase pairs are pruned, the constant and the
+                // complemented candidates are always proven
+                if (u1 == 0 || v1 == 0 || aiger_sign(u1) != aiger_sign(u2) ||
+                    aiger_sign(v1) != aiger_sign(v2))
+                    continue;
                 if ((xag->strash_prune(u1, v1) && xag->strash_prune(u2, v2)) ||
                     (xag->strash_prune(u1, v2) && xag->strash_prune(u2, v1)))
                 {
@@ -259,6 +590,7 @@ fastLEC::ret_vals fastLEC::Sweeper::logic_simulation()
     }
 
     this->xag->init_var_replace();
+    this->settled.assign(eql_classes.size(), false);
 
     printf("c [netlist] logic simulation done. ret = %d [time = %.2f]\n",
            ret,
@@ -268,40 +600,130 @@ fastLEC::ret_vals fastLEC::Sweeper::logic_simulation()
     return ret;
 }
 
+unsigned Sweeper::cut_sweeping()
+{
+    int k = Param::get().custom_params.sw_cut_size;
+    if (k <= 0 || this->eql_classes.empty())
+        return 0;
+    double start_time = ResMgr::get().get_runtime();
+
+    // the unsettled pairs, by their larger variable
+    std::vector<std::vector<unsigned>> pairs_at(this->xag->max_var + 1);
+    unsigned n_pairs = 0;
+    for (unsigned i = 0; i < this->eql_classes.size(); i++)
+    {
+        if (this->settled[i])
+            continue;
+        int v = std::max(aiger_var(eql_classes[i][0]),
+                         aiger_var(eql_classes[i][1]));
+        pairs_at[v].push_back(i);
+        n_pairs++;
+    }
+
+    // one bottom-up pass, a proven node shares the cuts of its
+    // representative, so that its fanouts can be proven as well
+    CutEngine cuts(*this->xag, k, Param::get().custom_params.sw_cut_num);
+    unsigned n_proven = 0;
+    for (int v = 0; v <= this->xag->max_var; v++)
+    {
+        cuts.compute(v);
+        bool substituted = false;
+        for (unsigned i : pairs_at[v])
+        {
+            int l1 = eql_classes[i][0], l2 = eql_classes[i][1];
+            if (!cuts.equal(l1, l2))
+                continue;
+            this->settled[i] = true;
+            this->post_proof(i, ret_vals::ret_UNS);
+            n_proven++;
+            if (!substituted)
+            {
+                // v = rep, the literal of the other node in the pair
+                bool v_first = aiger_var(l1) == v;
+                int rep = v_first ? l2 : l1;
+                int lit = v_first ? l1 : l2;
+                cuts.substitute(v, rep ^ aiger_sign(lit));
+                substituted = true;
+            }
+        }
+    }
+
+    printf("c [Cut] %u / %u pairs proven by %d-cuts [time = %.2f]\n",
+           n_proven,
+           n_pairs,
+           k,
+           ResMgr::get().get_runtime() - start_time);
+    fflush(stdout);
+    return n_proven;
+}
+
 std::shared_ptr<fastLEC::XAG> Sweeper::next_sub_graph()
 {
     std::shared_ptr<fastLEC::XAG> sub_xag = nullptr;
     sub_graph_string = "";
-    if (this->next_class_idx == this->eql_classes.size())
+
+    auto class_string = [&](unsigned idx) -> std::string
     {
-        sub_xag = this->xag->extract_sub_graph({this->xag->PO});
         std::ostringstream oss;
-        oss << "c*[ Final ] PO-lit{" << std::to_string(this->xag->PO)
-            << "}, v{ " << aiger_var(this->xag->PO) << "}, cone={ "
-            << xag->varcone_sizes[aiger_var(this->xag->PO)] << "}"
-            << ", PI= " << sub_xag->PI.size();
+        oss << "] l{" << std::setw(5) << eql_classes[idx][0] << ", "
+            << std::setw(5) << eql_classes[idx][1] << "}, v={" << std::setw(5)
+            << (eql_classes[idx][0] / 2) << ", " << std::setw(5)
+            << (eql_classes[idx][1] / 2) << "}, cone={" << std::setw(5)
+            << xag->varcone_sizes[eql_classes[idx][0] / 2] << ", "
+            << std::setw(5) << xag->varcone_sizes[eql_classes[idx][1] / 2]
+            << "}, PI= " << sub_xag->PI.size();
+        return oss.str();
+    };
+
+    while (this->next_class_idx < this->eql_classes.size() &&
+           this->settled[this->next_class_idx])
+        this->next_class_idx++;
+
+    if (this->next_class_idx < this->eql_classes.size())
+    {
+        cur_class_idx = this->next_class_idx++;
+        cur_attempt = 0;
+        sub_xag = this->take_prepared(cur_class_idx);
+        if (sub_xag == nullptr)
+            sub_xag = this->extract_locked(this->eql_classes[cur_class_idx]);
+        std::ostringstream oss;
+        oss << "c*[" << std::setw(4) << (cur_class_idx + 1) << "/"
+            << std::setw(4) << eql_classes.size()
+            << class_string(cur_class_idx);
         sub_graph_string += oss.str();
     }
-    else if (this->next_class_idx < this->eql_classes.size())
+    else if (!this->retry_queue.empty() &&
+             ResMgr::get().get_runtime() < Param::get().timeout)
     {
-        sub_xag = this->xag->extract_sub_graph(
-            this->eql_classes[this->next_class_idx]);
+        cur_class_idx = this->retry_queue.front().first;
+        cur_attempt = this->retry_queue.front().second;
+        this->retry_queue.pop_front();
+        this->stop_preparing();
+        sub_xag = this->extract_locked(this->eql_classes[cur_class_idx]);
         std::ostringstream oss;
-        oss << "c*[" << std::setw(4) << (next_class_idx + 1) << "/"
-            << std::setw(4) << eql_classes.size() << "] l{" << std::setw(5)
-            << eql_classes[this->next_class_idx][0] << ", " << std::setw(5)
-            << eql_classes[this->next_class_idx][1] << "}, v={" << std::setw(5)
-            << (eql_classes[this->next_class_idx][0] / 2) << ", "
-            << std::setw(5) << (eql_classes[this->next_class_idx][1] / 2)
-            << "}, cone={" << std::setw(5)
-            << xag->varcone_sizes[eql_classes[this->next_class_idx][0] / 2]
-            << ", " << std::setw(5)
-            << xag->varcone_sizes[eql_classes[this->next_class_idx][1] / 2]
-            << "}, PI= " << sub_xag->PI.size();
+        oss << "c*[" << std::setw(4) << (cur_class_idx + 1) << "/retry"
+            << cur_attempt << class_string(cur_class_idx);
+        sub_graph_string += oss.str();
+    }
+    else if (this->next_class_idx == this->eql_classes.size() &&
+             this->defer_final)
+    {
+        this->stop_preparing();
+        this->final_deferred = true;
+    }
+    else if (this->next_class_idx == this->eql_classes.size())
+    {
+        cur_class_idx = this->next_class_idx++;
+        cur_attempt = 0;
+        this->stop_preparing();
+        sub_xag = this->extract_locked({this->xag->PO});
+        std::ostringstream oss;
+        oss << "c*[ Final ] PO-lit{" << std::to_string(this->xag->PO)
+            << "}, v{ " << aiger_var(this->xag->PO) << "}, cone={ "
+            << xag->varcone_sizes[aiger_var(this->xag->PO)] << "}"
+            << ", PI= " << sub_xag->PI.size();
         sub_graph_string += oss.str();
     }
-
-    this->next_class_idx++;
 
     if (sub_xag && Param::get().custom_params.log_sub_aiger)
     {
@@ -325,6 +747,513 @@ std::shared_ptr<fastLEC::XAG> Sweeper::next_sub_graph()
     return sub_xag;
 }
 
+fastLEC::ret_vals Sweeper::reduce_graph(int pass)
+{
+    unsigned n_gates = this->xag->used_gates.size();
+    this->xag->compact();
+    printf("c [Sweeper] pass %d: %u merges, reduce %u -> %zu gates, %zu PIs\n",
+           pass,
+           (unsigned)this->merged_vars.size(),
+           n_gates,
+           this->xag->used_gates.size(),
+           this->xag->PI.size());
+    fflush(stdout);
+
+    if (this->xag->PO == 0)
+        return ret_vals::ret_UNS;
+    if (this->xag->PO == 1)
+        return ret_vals::ret_SAT;
+    return ret_vals::ret_UNK;
+}
+
+// ---------------------------------------------------
+// ODC-aware merging
+// ---------------------------------------------------
+
+void Sweeper::odc_window(int var,
+                         std::vector<int> &window,
+                         std::vector<int> &outputs)
+{
+    // the window is capped, the nodes left out are observed as outputs
+    const unsigned max_window = 64;
+    unsigned levels = (unsigned)Param::get().custom_params.sw_odc_levels;
+    auto is_root = [&](int v)
+    {
+        return this->xag->replace_lit(aiger_pos_lit(v)) == aiger_pos_lit(v);
+    };
+
+    odc_mark.resize(this->xag->max_var + 1, 0);
+    window.assign(1, var);
+    odc_mark[var] = 1;
+    std::vector<int> frontier = {var}, next;
+    for (unsigned level = 0; level < levels && !frontier.empty(); level++)
+    {
+        next.clear();
+        for (int u : frontier)
+        {
+            for (int x : odc_users[u])
+            {
+                if (odc_mark[x] || !is_root(x) || window.size() >= max_window)
+                    continue;
+                odc_mark[x] = 1;
+                window.push_back(x);
+                next.push_back(x);
+            }
+        }
+        frontier.swap(next);
+    }
+    std::sort(window.begin(), window.end());
+
+    int po_var = aiger_var(this->xag->replace_lit(this->xag->PO));
+    outputs.clear();
+    for (int w : window)
+    {
+        bool observed = w == po_var;
+        for (int x : odc_users[w])
+            if (!odc_mark[x] && is_root(x))
+                observed = true;
+        if (observed)
+            outputs.push_back(w);
+    }
+    for (int w : window)
+        odc_mark[w] = 0;
+}
+
+unsigned Sweeper::compute_odc_candidates()
+{
+    odc_candidates.clear();
+    odc_next = 0;
+    n_odc_merged = 0;
+    int max_var = this->xag->max_var;
+    auto is_gate = [&](int v)
+    {
+        return this->xag->gates[v].type == GateType::AND2 ||
+            this->xag->gates[v].type == GateType::XOR2;
+    };
+
+    // the live nodes (the cone of the PO over the merges) and their fanouts
+    std::vector<bool> live(max_var + 1, false);
+    live[aiger_var(this->xag->replace_lit(this->xag->PO))] = true;
+    odc_users.assign(max_var + 1, {});
+    for (int v = max_var; v > 0; v--)
+    {
+        if (!live[v] || !is_gate(v))
+            continue;
+        for (int k = 0; k < 2; k++)
+        {
+            int f = aiger_var(this->xag->replace_lit(xag->gates[v].inputs[k]));
+            live[f] = true;
+            odc_users[f].push_back(v);
+        }
+    }
+
+    // random patterns on the live nodes
+    const unsigned n_words = 16;
+    std::vector<uint64_t> val((size_t)(max_var + 1) * n_words, 0);
+    auto words = [&](int v) { return &val[(size_t)v * n_words]; };
+    auto eval = [&](const Gate &g, unsigned w, auto in_word) -> uint64_t
+    {
+        uint64_t a = in_word(g.inputs[0], w);
+        uint64_t b = in_word(g.inputs[1], w);
+        return g.type == GateType::AND2 ? a & b : a ^ b;
+    };
+    auto org_word = [&](int lit, unsigned w) -> uint64_t
+    {
+        lit = this->xag->replace_lit(lit);
+        return words(aiger_var(lit))[w] ^ (aiger_sign(lit) ? ~0ull : 0ull);
+    };
+    for (int v = 1; v <= max_var; v++)
+    {
+        if (!live[v])
+            continue;
+        for (unsigned w = 0; w < n_words; w++)
+        {
+            if (this->xag->gates[v].type == GateType::PI)
+                words(v)[w] = ResMgr::get().random_uint64();
+            else if (is_gate(v))
+                words(v)[w] = eval(this->xag->gates[v], w, org_word);
+        }
+    }
+
+    // the node pairs compared beyond the side inputs
+    const uint64_t max_scan = 1ull << 22;
+    uint64_t n_scan = 0;
+
+    std::vector<int> window, outputs;
+    std::vector<uint64_t> flip, obs(n_words);
+    for (int n = 1; n <= max_var; n++)
+    {
+        if (!live[n] || !is_gate(n) ||
+            this->xag->replace_lit(aiger_pos_lit(n)) != aiger_pos_lit(n))
+            continue;
+
+        // re-simulate the window with n flipped, the observability is where
+        // an output changes
+        odc_window(n, window, outputs);
+        auto index = [&](int v) -> int
+        {
+            auto it = std::lower_bound(window.begin(), window.end(), v);
+            return it != window.end() && *it == v ? it - window.begin() : -1;
+        };
+        flip.assign(window.size() * n_words, 0);
+        auto flip_word = [&](int lit, unsigned w) -> uint64_t
+        {
+            lit = this->xag->replace_lit(lit);
+            int i = index(aiger_var(lit));
+            if (i < 0)
+                return org_word(lit, w);
+            return flip[i * n_words + w] ^ (aiger_sign(lit) ? ~0ull : 0ull);
+        };
+        for (unsigned i = 0; i < window.size(); i++)
+            for (unsigned w = 0; w < n_words; w++)
+                flip[i * n_words + w] = window[i] == n
+                    ? ~words(n)[w]
+                    : eval(this->xag->gates[window[i]], w, flip_word);
+        std::fill(obs.begin(), obs.end(), 0);
+        for (int o : outputs)
+            for (unsigned w = 0; w < n_words; w++)
+                obs[w] |= flip[index(o) * n_words + w] ^ words(o)[w];
+        bool partial = false;
+        for (unsigned w = 0; w < n_words; w++)
+            partial |= obs[w] != ~0ull;
+        if (!partial)
+            continue; // only the exact equivalences, left to the sweeping
+
+        // n agrees with rep wherever it is observable
+        auto agree = [&](int rep) -> bool
+        {
+            for (unsigned w = 0; w < n_words; w++)
+                if ((words(n)[w] ^ org_word(rep, w)) & obs[w])
+                    return false;
+            return true;
+        };
+        int rep = -1;
+        if (agree(0))
+            rep = 0;
+        else if (agree(1))
+            rep = 1;
+        for (unsigned i = 0; i < window.size() && rep < 0; i++)
+        {
+            // the side inputs of the window before n
+            const Gate &g = this->xag->gates[window[i]];
+            for (int k = 0; k < 2 && rep < 0; k++)
+            {
+                int m = aiger_var(this->xag->replace_lit(g.inputs[k]));
+                if (m == 0 || m >= n)
+                    continue;
+                if (agree(aiger_pos_lit(m)))
+                    rep = aiger_pos_lit(m);
+                else if (agree(aiger_neg_lit(m)))
+                    rep = aiger_neg_lit(m);
+            }
+        }
+        // then the other live nodes before n, within the scan limit
+        for (int m = n - 1; m > 0 && rep < 0 && n_scan < max_scan; m--)
+        {
+            if (!live[m] ||
+                this->xag->replace_lit(aiger_pos_lit(m)) != aiger_pos_lit(m))
+                continue;
+            n_scan++;
+            if (agree(aiger_pos_lit(m)))
+                rep = aiger_pos_lit(m);
+            else if (agree(aiger_neg_lit(m)))
+                rep = aiger_neg_lit(m);
+        }
+        if (rep >= 0)
+            odc_candidates.emplace_back(n, rep);
+    }
+    return odc_candidates.size();
+}
+
+std::shared_ptr<fastLEC::XAG> Sweeper::next_odc_graph()
+{
+    std::vector<int> window, outputs;
+    while (odc_next < odc_candidates.size())
+    {
+        cur_odc = odc_candidates[odc_next++];
+        int n = cur_odc.first;
+        // merged by an earlier candidate
+        if (this->xag->replace_lit(aiger_pos_lit(n)) != aiger_pos_lit(n))
+            continue;
+
+        odc_window(n, window, outputs);
+        std::shared_ptr<fastLEC::XAG> miter =
+            this->xag->extract_odc_miter(n, cur_odc.second, window, outputs);
+
+        std::ostringstream oss;
+        oss << "c*[odc " << std::setw(4) << odc_next << "/" << std::setw(4)
+            << odc_candidates.size() << "] v{" << std::setw(5) << n
+            << "} -> l{" << std::setw(5) << cur_odc.second
+            << "}, window= " << window.size()
+            << ", outputs= " << outputs.size() << ", PI= " << miter->PI.size();
+        sub_graph_string = oss.str();
+        return miter;
+    }
+    return nullptr;
+}
+
+void Sweeper::post_odc_proof(fastLEC::ret_vals ret)
+{
+    if (ret != ret_vals::ret_UNS)
+        return;
+
+    int n = cur_odc.first;
+    std::lock_guard<std::mutex> lock(this->replace_mtx);
+    int rep = this->xag->replace_lit(cur_odc.second);
+    if (int v = this->xag->merge_lits(aiger_pos_lit(n), rep))
+    {
+        this->merged_vars.push_back(v);
+        n_odc_merged++;
+        // the fanouts of n are read from rep now
+        auto &users = odc_users[aiger_var(rep)];
+        users.insert(users.end(), odc_users[n].begin(), odc_users[n].end());
+    }
+}
+
+// ---------------------------------------------------
+// sub-graph preparation
+// ---------------------------------------------------
+
+void Sweeper::prepare_loop()
+{
+    unsigned depth = (unsigned)Param::get().custom_params.sw_prefetch;
+    while (true)
+    {
+        unsigned idx = 0;
+        {
+            std::unique_lock<std::mutex> lock(prep_mtx);
+            prep_cv.wait(lock,
+                         [&]()
+                         {
+                             return prep_stop || prepared.size() < depth;
+                         });
+            while (prep_next_idx < eql_classes.size() &&
+                   settled[prep_next_idx])
+                prep_next_idx++;
+            if (prep_stop || prep_next_idx >= eql_classes.size())
+                return;
+            idx = prep_next_idx++;
+        }
+
+        PreparedSubGraph prep;
+        prep.class_idx = idx;
+        {
+            std::lock_guard<std::mutex> lock(replace_mtx);
+            prep.n_merged = merged_vars.size();
+            prep.sub_xag = xag->extract_sub_graph(eql_classes[idx]);
+        }
+        // the CNF is kept in the sub-graph
+        if (Param::get().mode == Mode::SAT_sweeping)
+            prep.sub_xag->construct_cnf_from_this_xag();
+
+        {
+            std::lock_guard<std::mutex> lock(prep_mtx);
+            prepared.push_back(prep);
+        }
+        prep_cv.notify_all();
+    }
+}
+
+void Sweeper::stop_preparing()
+{
+    {
+        std::lock_guard<std::mutex> lock(prep_mtx);
+        prep_stop = true;
+    }
+    prep_cv.notify_all();
+    if (prep_thread.joinable())
+        prep_thread.join();
+    prepared.clear();
+    prep_stop = false;
+}
+
+std::shared_ptr<fastLEC::XAG> Sweeper::take_prepared(unsigned class_idx)
+{
+    if (Param::get().custom_params.sw_prefetch <= 0)
+        return nullptr;
+
+    std::unique_lock<std::mutex> lock(prep_mtx);
+    if (!prep_thread.joinable())
+    {
+        // the helper prepares the classes in the same order from here
+        prep_next_idx = class_idx;
+        prep_thread = std::thread(&Sweeper::prepare_loop, this);
+    }
+    prep_cv.wait(lock,
+                 [&]()
+                 {
+                     return !prepared.empty() ||
+                         prep_next_idx >= eql_classes.size();
+                 });
+    while (!prepared.empty() && prepared.front().class_idx < class_idx)
+        prepared.pop_front();
+    if (prepared.empty() || prepared.front().class_idx != class_idx)
+        return nullptr;
+    PreparedSubGraph prep = prepared.front();
+    prepared.pop_front();
+    lock.unlock();
+    prep_cv.notify_all();
+
+    // only this thread merges, so merged_vars is stable here. the mapped
+    // parent variables are increasing, only the miter gate at the tail (and
+    // the constant at 0) map to -1
+    const std::vector<int> &sons = prep.sub_xag->son_var_mapper;
+    auto first = sons.begin() + 1, last = sons.end();
+    while (last != first && *(last - 1) < 0)
+        last--;
+    for (size_t i = prep.n_merged; i < merged_vars.size(); i++)
+    {
+        if (std::binary_search(first, last, merged_vars[i]))
+        {
+            n_prep_stale++;
+            return nullptr;
+        }
+    }
+    n_prep_used++;
+    return prep.sub_xag;
+}
+
+std::shared_ptr<fastLEC::XAG>
+Sweeper::extract_locked(const std::vector<int> &pos)
+{
+    std::lock_guard<std::mutex> lock(replace_mtx);
+    return this->xag->extract_sub_graph(pos);
+}
+
+Sweeper::iso_status
+Sweeper::match_isomorphic(std::shared_ptr<fastLEC::XAG> sub_graph,
+                          fastLEC::ret_vals &ret,
+                          std::string &cex)
+{
+    iso_form.clear();
+    if (!Param::get().custom_params.iso_reuse)
+        return iso_new;
+
+    std::vector<int> form, pi_label;
+    std::vector<bool> pi_flip;
+    sub_graph->canonical_form(form, pi_label, pi_flip);
+
+    auto it = iso_records.find(form);
+    if (it == iso_records.end())
+    {
+        iso_form.swap(form);
+        iso_pi_label.swap(pi_label);
+        iso_pi_flip.swap(pi_flip);
+        iso_PI = sub_graph->PI;
+        return iso_new;
+    }
+
+    const IsoRecord &rec = it->second;
+    // remap the canonical counterexample to the PIs of this sub-graph
+    ret = rec.result;
+    cex.clear();
+    if (!rec.cex.empty())
+    {
+        for (int pi : sub_graph->PI)
+        {
+            int v = aiger_var(pi);
+            int label = pi_label[v];
+            bool val = label > 0 && rec.cex[label - 1] == '1';
+            cex.push_back(val ^ pi_flip[v] ? '1' : '0');
+        }
+    }
+    n_iso_reused++;
+    return iso_solved;
+}
+
+void Sweeper::record_isomorphic(fastLEC::ret_vals ret, const std::string &cex)
+{
+    // an unsolved sub-graph is not recorded, the later isomorphic ones try
+    // again
+    if (iso_form.empty() || ret == ret_vals::ret_UNK)
+        return;
+
+    IsoRecord rec;
+    rec.result = ret;
+    if (!cex.empty())
+    {
+        rec.cex.assign(iso_form.back(), '0');
+        for (unsigned i = 0; i < iso_PI.size() && i < cex.size(); i++)
+        {
+            int v = aiger_var(iso_PI[i]);
+            if (iso_pi_label[v] > 0)
+                rec.cex[iso_pi_label[v] - 1] =
+                    (cex[i] == '1') ^ iso_pi_flip[v] ? '1' : '0';
+        }
+    }
+    iso_records.emplace(std::move(iso_form), std::move(rec));
+    iso_form.clear();
+}
+
+std::shared_ptr<fastLEC::XAG> Sweeper::speculative_graph()
+{
+    std::vector<std::vector<int>> pairs;
+    for (unsigned i = 0; i < this->eql_classes.size(); i++)
+        if (!this->settled[i])
+            pairs.push_back(this->eql_classes[i]);
+
+    this->spec_graph = nullptr;
+    if (!pairs.empty())
+        this->spec_graph = this->xag->speculative_reduction(pairs);
+    return this->spec_graph;
+}
+
+fastLEC::ret_vals Sweeper::refine_speculation(const std::string &cex,
+                                              unsigned &n_dropped)
+{
+    n_dropped = 0;
+    if (this->spec_graph == nullptr)
+        return ret_vals::ret_UNK;
+
+    // replay the counterexample on the original XAG, the PIs out of the
+    // speculative model are 0
+    std::vector<char> val(this->xag->max_var + 1, 0);
+    for (unsigned i = 0; i < spec_graph->PI.size() && i < cex.size(); i++)
+    {
+        int v = spec_graph->son_var_mapper[aiger_var(spec_graph->PI[i])];
+        val[v] = cex[i] == '1';
+    }
+    auto value = [&](int lit) -> bool
+    {
+        return val[aiger_var(lit)] ^ aiger_sign(lit);
+    };
+    for (int v = 1; v <= this->xag->max_var; v++)
+    {
+        const Gate &g = this->xag->gates[v];
+        if (g.type == GateType::AND2)
+            val[v] = value(g.inputs[0]) & value(g.inputs[1]);
+        else if (g.type == GateType::XOR2)
+            val[v] = value(g.inputs[0]) ^ value(g.inputs[1]);
+    }
+
+    if (value(this->xag->PO))
+        return ret_vals::ret_SAT;
+
+    // the first failing miter in topological order is a real difference, so
+    // at least one pair is dropped
+    for (unsigned i = 0; i < this->eql_classes.size(); i++)
+    {
+        if (this->settled[i] ||
+            value(eql_classes[i][0]) == value(eql_classes[i][1]))
+            continue;
+        this->settled[i] = true;
+        this->post_proof(i, ret_vals::ret_SAT);
+        n_dropped++;
+    }
+    return ret_vals::ret_UNK;
+}
+
+void Sweeper::commit_speculation()
+{
+    for (unsigned i = 0; i < this->eql_classes.size(); i++)
+    {
+        if (this->settled[i])
+            continue;
+        this->settled[i] = true;
+        this->post_proof(i, ret_vals::ret_UNS);
+    }
+}
+
 void Sweeper::log_next_sub_cnfs()
 {
     auto cnf = tmp_next_graph->construct_cnf_from_this_xag();
@@ -332,7 +1261,7 @@ void Sweeper::log_next_sub_cnfs()
     std::string log_file = Param::get().custom_params.log_dir;
     check_dir_and_create(log_file);
     log_file += "/" + Param::get().filename;
-    log_file += "_" + std::to_string(this->next_class_idx) + ".cnf";
+    log_file += "_" + std::to_string(this->cur_class_idx + 1) + ".cnf";
     printf("c [log] log file: %s\n", log_file.c_str());
     fflush(stdout);
     cnf->log_cnf(log_file);
@@ -345,7 +1274,7 @@ void Sweeper::log_next_sub_aiger()
     std::string log_file = Param::get().custom_params.log_dir;
     check_dir_and_create(log_file);
     log_file += "/" + Param::get().filename;
-    log_file += "_" + std::to_string(this->next_class_idx) + ".aig";
+    log_file += "_" + std::to_string(this->cur_class_idx + 1) + ".aig";
     printf("c [log] log file: %s\n", log_file.c_str());
     fflush(stdout);
 
@@ -359,7 +1288,7 @@ void Sweeper::log_next_sub_features()
     std::string log_file = Param::get().custom_params.log_dir;
     check_dir_and_create(log_file);
     log_file += "/" + Param::get().filename;
-    log_file += "_" + std::to_string(this->next_class_idx) + ".txt";
+    log_file += "_" + std::to_string(this->cur_class_idx + 1) + ".txt";
     printf("c [log] log file: %s\n", log_file.c_str());
     fflush(stdout);
 
@@ -371,6 +1300,20 @@ void Sweeper::log_next_sub_features()
 }
 
 void Sweeper::post_proof(fastLEC::ret_vals ret)
+{
+    this->post_proof(this->cur_class_idx, ret);
+}
+
+bool Sweeper::defer_last()
+{
+    if (this->is_final_sub_graph() ||
+        (int)cur_attempt >= Param::get().custom_params.sw_max_retry)
+        return false;
+    this->retry_queue.emplace_back(cur_class_idx, cur_attempt + 1);
+    return true;
+}
+
+void Sweeper::post_proof(unsigned last_id, fastLEC::ret_vals ret)
 {
     if (ret == ret_vals::ret_UNK &&
         (Param::get().custom_params.log_sub_aiger ||
@@ -378,7 +1321,6 @@ void Sweeper::post_proof(fastLEC::ret_vals ret)
          Param::get().custom_params.log_features))
         ret = ret_vals::ret_UNS;
 
-    unsigned last_id = this->next_class_idx - 1;
     if (last_id >= this->eql_classes.size())
         return;
 
@@ -391,33 +1333,12 @@ void Sweeper::post_proof(fastLEC::ret_vals ret)
         for (auto &p : this->skip_pairs[last_id])
             this->proved_pairs.emplace_back(p);
 
-        std::function<int(int)> find_f = [&](int v) -> int
-        {
-            if (this->xag->var_replace[v] != v)
-                this->xag->var_replace[v] = find_f(this->xag->var_replace[v]);
-
-            return this->xag->var_replace[v];
-        };
-
-        // merge the larger topological order to the smaller one
-        int rootX = find_f(aiger_var(l1));
-        int rootY = find_f(aiger_var(l2));
-        // if (netlist.topo_idx[rootX] < netlist.topo_idx[rootY])
-        if (rootX < rootY)
-            this->xag->var_replace[rootY] = rootX;
-        else
-            this->xag->var_replace[rootX] = rootY;
-
+        std::lock_guard<std::mutex> lock(this->replace_mtx);
+        if (int v = this->xag->merge_lits(l1, l2))
+            this->merged_vars.push_back(v);
         for (auto &p : this->skip_pairs[last_id])
-        {
-            rootX = find_f(aiger_var(p.first));
-            rootY = find_f(aiger_var(p.second));
-            // if (netlist.topo_idx[rootX] < netlist.topo_idx[rootY])
-            if (rootX < rootY)
-                this->xag->var_replace[rootY] = rootX;
-            else
-                this->xag->var_replace[rootX] = rootY;
-        }
+            if (int v = this->xag->merge_lits(p.first, p.second))
+                this->merged_vars.push_back(v);
     }
     else if (ret == ret_vals::ret_SAT)
     {
@@ -1,6 +1,11 @@
 #pragma once
 
+#include <condition_variable>
+#include <deque>
 #include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 
 #include "XAG.hpp"
 #include "basic.hpp"
@@ -15,6 +20,11 @@ class Sweeper
 
     // eql classes
     unsigned next_class_idx = 0;
+    // the class of the last sub-graph and how many times it is retried
+    unsigned cur_class_idx = 0;
+    unsigned cur_attempt = 0;
+    // the unresolved classes to retry with larger budgets: (class, attempt)
+    std::deque<std::pair<unsigned, unsigned>> retry_queue;
     // the index of a aiger literal in eql_class
     std::vector<int> class_index;
     // the potential-eql node pairs (aiger literal pair)
@@ -25,17 +35,77 @@ class Sweeper
     std::vector<std::pair<int, int>> proved_pairs;
     // the rejected pairs
     std::vector<std::pair<int, int>> rejected_pairs;
+    // the pairs settled by speculative reduction, skipped by next_sub_graph
+    std::vector<bool> settled;
+    // the last speculatively reduced model
+    std::shared_ptr<fastLEC::XAG> spec_graph = nullptr;
+
+    // the first-pass sub-graphs are prepared ahead on a helper thread, a
+    // prepared one is stale if a later merge replaces a variable of its cone
+    struct PreparedSubGraph
+    {
+        unsigned class_idx;
+        std::shared_ptr<fastLEC::XAG> sub_xag;
+        size_t n_merged; // merged_vars.size() at the extraction
+    };
+    std::deque<PreparedSubGraph> prepared;
+    unsigned prep_next_idx = 0;
+    bool prep_stop = false;
+    std::thread prep_thread;
+    std::mutex prep_mtx;
+    std::condition_variable prep_cv;
+    // guards var_replace between the extractions and the merges
+    std::mutex replace_mtx;
+    // the root variables replaced by the merges, in order
+    std::vector<int> merged_vars;
+
+    // ODC-aware merging: (node variable, literal) candidates that agree
+    // wherever the node is observable within the window levels
+    std::vector<std::pair<int, int>> odc_candidates;
+    unsigned odc_next = 0;
+    std::pair<int, int> cur_odc = {0, 0};
+    // the fanouts of the live nodes, extended by the ODC merges
+    std::vector<std::vector<int>> odc_users;
+    std::vector<char> odc_mark;
+    // the window of var (its TFO within the levels, topological order) and
+    // its outputs: the PO and the nodes with a fanout out of the window
+    void odc_window(int var,
+                    std::vector<int> &window,
+                    std::vector<int> &outputs);
+
+    void prepare_loop();
+    void stop_preparing();
+    // the prepared sub-graph of the class, nullptr if none or stale
+    std::shared_ptr<fastLEC::XAG> take_prepared(unsigned class_idx);
+    std::shared_ptr<fastLEC::XAG> extract_locked(const std::vector<int> &pos);
 
     std::shared_ptr<fastLEC::XAG> tmp_next_graph = nullptr;
 
+    // split the large classes with distance-1 flips of random patterns
+    fastLEC::ret_vals targeted_simulation();
+
+    // the solved sub-graphs, by canonical form
+    struct IsoRecord
+    {
+        fastLEC::ret_vals result = ret_vals::ret_UNK;
+        std::string cex; // canonical PI values of the cex
+    };
+    std::unordered_map<std::vector<int>, IsoRecord> iso_records;
+    // canonical labeling of the last new sub-graph
+    std::vector<int> iso_form, iso_pi_label, iso_PI;
+    std::vector<bool> iso_pi_flip;
+
 public:
     Sweeper() = default;
     Sweeper(std::shared_ptr<fastLEC::XAG> xag) : xag(xag) {}
-    ~Sweeper() = default;
+    ~Sweeper() { stop_preparing(); }
 
     void clear();
 
     fastLEC::ret_vals logic_simulation();
+    // prove the candidate pairs sharing a cut with equal truth tables,
+    // return the number of the proven pairs
+    unsigned cut_sweeping();
 
     std::string sub_graph_string;
     // get the next sub-graph in XAG format
@@ -43,8 +113,57 @@ public:
     void log_next_sub_aiger();
     void log_next_sub_cnfs();
     void log_next_sub_features();
+    // whether the last sub-graph is the final PO check
+    bool is_final_sub_graph() const
+    {
+        return cur_class_idx == eql_classes.size();
+    }
+    unsigned attempt() const { return cur_attempt; }
+    // retry the last sub-graph after the first pass, with a larger budget
+    bool defer_last();
     // the nodes in the last class are proven to be equivalent or not equivalent
     void post_proof(fastLEC::ret_vals ret);
+    void post_proof(unsigned class_id, fastLEC::ret_vals ret);
+
+    // speculative reduction: all the unsettled pairs are checked at once in
+    // a speculatively reduced model (nullptr if no pair is left). a
+    // counterexample (PI order of that model) drops the pairs it separates
+    // (n_dropped), ret_SAT if it also sets the PO; UNSAT proves the rest.
+    std::shared_ptr<fastLEC::XAG> speculative_graph();
+    fastLEC::ret_vals refine_speculation(const std::string &cex,
+                                         unsigned &n_dropped);
+    void commit_speculation();
+
+    // reuse the results of isomorphic sub-graphs (up to PI permutation and
+    // polarity). a new sub-graph is recorded by record_isomorphic once it
+    // is solved.
+    enum iso_status
+    {
+        iso_new,    // to be solved, then record_isomorphic
+        iso_solved, // ret and cex (sub-graph PI order) are reused
+    };
+    iso_status match_isomorphic(std::shared_ptr<fastLEC::XAG> sub_graph,
+                                fastLEC::ret_vals &ret,
+                                std::string &cex);
+    void record_isomorphic(fastLEC::ret_vals ret, const std::string &cex);
+    unsigned n_iso_reused = 0;
+    unsigned n_prep_used = 0, n_prep_stale = 0;
+
+    // the final PO check of the pass is deferred (final_deferred), for the
+    // ODC-aware merging or the next pass on the reduced graph
+    bool defer_final = false;
+    bool final_deferred = false;
+    // compact the XAG with the merges of the last pass, ret_UNS or ret_SAT
+    // if the PO gets constant
+    fastLEC::ret_vals reduce_graph(int pass);
+    unsigned n_merges() const { return merged_vars.size(); }
+
+    // simulate the observability of the live nodes and collect the ODC
+    // candidates, then prove them one by one on their windowed miters
+    unsigned compute_odc_candidates();
+    std::shared_ptr<fastLEC::XAG> next_odc_graph();
+    void post_odc_proof(fastLEC::ret_vals ret);
+    unsigned n_odc_merged = 0;
 };
 
 } // namespace fastLEC
\ No newline at end of file
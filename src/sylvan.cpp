@@ -181,7 +181,8 @@ void clear_current_xag()
 
 bool is_timeout_reached()
 {
-    return fastLEC::ResMgr::get().get_runtime() > fastLEC::Param::get().timeout;
+    return fastLEC::ResMgr::get().get_runtime() >
+        fastLEC::Param::get().time_limit();
 }
 
 // Safe wrapper for sylvan_quit() - ensures it's only called once
@@ -341,7 +342,7 @@ fastLEC::Prover::para_BDD_sylvan(std::shared_ptr<fastLEC::XAG> xag, int n_t)
 
                 // Use fastLEC's runtime check
                 if (fastLEC::ResMgr::get().get_runtime() >
-                    fastLEC::Param::get().timeout)
+                    fastLEC::Param::get().time_limit())
                 {
                     printf("c [Sylvan] Timeout reached\n");
                     fflush(stdout);
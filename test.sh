@@ -8,3 +8,6 @@ BUILD_DIR="build"
 command="-m schedule_sweeping -c 8 -v 2 -t 100"
 
 ./${BUILD_DIR}/bin/fastLEC -i ./data/test_16_TOP11.aiger $command
+
+# a miter with unused inputs: the PI variables are not 1..n
+./${BUILD_DIR}/bin/fastLEC -i ./data/test_unused_PI.aiger $command